@@ -0,0 +1,166 @@
+/*
+ * NAME: Jonathan Chang
+ * EMAIL: j.a.chang820@gmail.com
+ * ID: 104853981
+ */ 
+
+#include <unistd.h>
+#include <errno.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#include "PerfCounters.h"
+
+static const uint32_t hw_type[PERF_NUM_EVENTS] = {
+  PERF_TYPE_HARDWARE, PERF_TYPE_HARDWARE, PERF_TYPE_HARDWARE,
+  PERF_TYPE_SOFTWARE
+};
+static const uint64_t hw_config[PERF_NUM_EVENTS] = {
+  PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS,
+  PERF_COUNT_HW_CACHE_MISSES, PERF_COUNT_SW_CONTEXT_SWITCHES
+};
+static const uint64_t sw_config[PERF_NUM_EVENTS] = {
+  PERF_COUNT_SW_TASK_CLOCK, (uint64_t) -1,
+  PERF_COUNT_SW_PAGE_FAULTS, PERF_COUNT_SW_CONTEXT_SWITCHES
+};
+
+
+/*! Opens one counter on the calling thread, any cpu. Retries in user
+    mode only when the kernel refuses to count kernel events. */
+static int open_counter(uint32_t type, uint64_t config) {
+  struct perf_event_attr attr;
+  int fd;
+  memset(&attr, 0, sizeof(attr));
+  attr.size = sizeof(attr);
+  attr.type = type;
+  attr.config = config;
+  attr.disabled = 1;
+  attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED |
+    PERF_FORMAT_TOTAL_TIME_RUNNING;
+  fd = syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+  if (fd == -1 && (errno == EACCES || errno == EPERM)) {
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    fd = syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+  }
+  return fd;
+}
+
+
+static void close_counters(struct PerfCounters *counters) {
+  int n;
+  for (n = 0; n < PERF_NUM_EVENTS; n++) {
+    if (counters->fd[n] != -1) close(counters->fd[n]);
+    counters->fd[n] = -1;
+  }
+}
+
+
+/*! Reads a counter and scales it up if the kernel multiplexed it. */
+static long long read_counter(int fd) {
+  uint64_t value[3];
+  if (fd == -1) return -1;
+  if (read(fd, value, sizeof(value)) != sizeof(value)) {
+    fprintf(stderr, "Performance counter could not be read.\r\n%s\r\n",
+	    strerror(errno));
+    return -1;
+  }
+  if (value[2] != 0 && value[2] < value[1])
+    return (long long) ((double) value[0] * value[1] / value[2]);
+  return (long long) value[0];
+}
+
+
+void PerfCounters_start(struct PerfCounters *counters) {
+  int n;
+  counters->source = PERF_HARDWARE;
+  for (n = 0; n < PERF_NUM_EVENTS; n++) {
+    counters->count[n] = -1;
+    counters->fd[n] = -1;
+  }
+  for (n = 0; n < PERF_NUM_EVENTS; n++) {
+    counters->fd[n] = open_counter(hw_type[n], hw_config[n]);
+    if (counters->fd[n] == -1) break;
+  }
+
+  if (n < PERF_NUM_EVENTS) { /* fall back to software events */
+    close_counters(counters);
+    counters->source = PERF_SOFTWARE;
+    for (n = 0; n < PERF_NUM_EVENTS; n++) {
+      if (sw_config[n] != (uint64_t) -1)
+	counters->fd[n] = open_counter(PERF_TYPE_SOFTWARE, sw_config[n]);
+    }
+    if (counters->fd[PERF_CYCLES] == -1) {
+      close_counters(counters);
+      counters->source = PERF_NONE;
+      return;
+    }
+  }
+
+  for (n = 0; n < PERF_NUM_EVENTS; n++) {
+    if (counters->fd[n] == -1) continue;
+    ioctl(counters->fd[n], PERF_EVENT_IOC_RESET, 0);
+    ioctl(counters->fd[n], PERF_EVENT_IOC_ENABLE, 0);
+  }
+}
+
+
+void PerfCounters_stop(struct PerfCounters *counters) {
+  int n;
+  for (n = 0; n < PERF_NUM_EVENTS; n++) {
+    if (counters->fd[n] == -1) continue;
+    ioctl(counters->fd[n], PERF_EVENT_IOC_DISABLE, 0);
+    counters->count[n] = read_counter(counters->fd[n]);
+  }
+  close_counters(counters);
+}
+
+
+void PerfCounters_clear(struct PerfCounters *total) {
+  int n;
+  for (n = 0; n < PERF_NUM_EVENTS; n++) {
+    total->fd[n] = -1;
+    total->count[n] = 0;
+  }
+  total->source = PERF_HARDWARE;
+}
+
+
+/*! Accumulates one thread's counts. The total degrades to the weakest
+    source seen across threads. */
+void PerfCounters_add(struct PerfCounters *total,
+		      struct PerfCounters *counters) {
+  int n;
+  if (counters->source < total->source) total->source = counters->source;
+  for (n = 0; n < PERF_NUM_EVENTS; n++) {
+    if (counters->count[n] == -1 || total->count[n] == -1)
+      total->count[n] = -1;
+    else
+      total->count[n] += counters->count[n];
+  }
+}
+
+
+/*! Writes ",cycles,instructions,llc-misses,context-switches,source"
+    normalized per operation; unavailable counts are printed as -1. */
+int PerfCounters_format(char *buf, struct PerfCounters *total,
+			long operations) {
+  static const char *source_name[] = {"none", "sw", "hw"};
+  double per_op[PERF_NUM_EVENTS];
+  int n;
+  for (n = 0; n < PERF_NUM_EVENTS; n++) {
+    if (total->source == PERF_NONE || total->count[n] == -1)
+      per_op[n] = -1;
+    else
+      per_op[n] = (double) total->count[n] / operations;
+  }
+  return sprintf(buf, ",%.3f,%.3f,%.3f,%.3f,%s",
+		 per_op[PERF_CYCLES],
+		 per_op[PERF_INSTRUCTIONS],
+		 per_op[PERF_LLC_MISSES],
+		 per_op[PERF_CONTEXT_SWITCHES],
+		 source_name[total->source]);
+}
@@ -0,0 +1,142 @@
+/*
+ * NAME: Jonathan Chang
+ * EMAIL: j.a.chang820@gmail.com
+ * ID: 104853981
+ */ 
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <sched.h>
+#include "QueueLock.h"
+
+/* pauses a waiter spins through before it gives up its CPU once */
+#define SPIN_LIMIT 64
+
+
+static inline void cpu_relax(void) {
+#if defined(__x86_64__) || defined(__i386__)
+  __asm__ __volatile__("pause" ::: "memory");
+#else
+  __asm__ __volatile__("" ::: "memory");
+#endif
+}
+
+
+/*! One step of a wait. A FIFO lock can only be handed to the next
+    waiter in line, so when that waiter has no CPU every other one
+    would spin out its whole time slice; yielding now and then lets it
+    run when threads outnumber CPUs. */
+static inline void spin_wait(unsigned int *spins) {
+  if (++*spins < SPIN_LIMIT) {
+    cpu_relax();
+    return;
+  }
+  *spins = 0;
+  sched_yield();
+}
+
+
+static struct CLHNode *new_clh_node(void) {
+  struct CLHNode *node;
+  if (posix_memalign((void**) &node, CACHE_LINE_SIZE,
+		     sizeof(struct CLHNode)) != 0) {
+    fprintf(stderr, "Insufficient memory for CLH lock node.\r\n");
+    exit(2);
+  }
+  node->locked = 0;
+  return node;
+}
+
+
+void TicketLock_init(struct TicketLock *lock) {
+  lock->next_ticket = 0;
+  lock->now_serving = 0;
+}
+
+
+void TicketLock_lock(struct TicketLock *lock) {
+  unsigned int ticket = __sync_fetch_and_add(&lock->next_ticket, 1);
+  unsigned int spins = 0;
+  while (__atomic_load_n(&lock->now_serving, __ATOMIC_ACQUIRE) != ticket)
+    spin_wait(&spins);
+}
+
+
+void TicketLock_unlock(struct TicketLock *lock) {
+  /* only the holder writes now_serving */
+  __atomic_store_n(&lock->now_serving, lock->now_serving + 1,
+		   __ATOMIC_RELEASE);
+}
+
+
+void MCSLock_init(struct MCSLock *lock) {
+  lock->tail = NULL;
+}
+
+
+void MCSLock_lock(struct MCSLock *lock, struct MCSNode *node) {
+  struct MCSNode *pred;
+  unsigned int spins = 0;
+  node->next = NULL;
+  node->locked = 1;
+  pred = __atomic_exchange_n(&lock->tail, node, __ATOMIC_ACQ_REL);
+  if (pred == NULL) return; /* lock was free */
+  __atomic_store_n(&pred->next, node, __ATOMIC_RELEASE);
+  while (__atomic_load_n(&node->locked, __ATOMIC_ACQUIRE))
+    spin_wait(&spins);
+}
+
+
+void MCSLock_unlock(struct MCSLock *lock, struct MCSNode *node) {
+  struct MCSNode *succ = __atomic_load_n(&node->next, __ATOMIC_ACQUIRE);
+  unsigned int spins = 0;
+  if (succ == NULL) {
+    /* no known successor: try to swing tail back to empty */
+    if (__sync_bool_compare_and_swap(&lock->tail, node, NULL))
+      return;
+    /* a successor is between its exchange and linking itself */
+    while ((succ = __atomic_load_n(&node->next, __ATOMIC_ACQUIRE)) == NULL)
+      spin_wait(&spins);
+  }
+  __atomic_store_n(&succ->locked, 0, __ATOMIC_RELEASE);
+}
+
+
+void CLHLock_init(struct CLHLock *lock) {
+  lock->tail = new_clh_node();
+}
+
+
+void CLHLock_destroy(struct CLHLock *lock) {
+  free(lock->tail);
+  lock->tail = NULL;
+}
+
+
+void CLHThread_init(struct CLHThread *self) {
+  self->mine = new_clh_node();
+  self->pred = NULL;
+}
+
+
+void CLHThread_destroy(struct CLHThread *self) {
+  free(self->mine);
+  self->mine = NULL;
+}
+
+
+void CLHLock_lock(struct CLHLock *lock, struct CLHThread *self) {
+  unsigned int spins = 0;
+  self->mine->locked = 1;
+  self->pred = __atomic_exchange_n(&lock->tail, self->mine, __ATOMIC_ACQ_REL);
+  while (__atomic_load_n(&self->pred->locked, __ATOMIC_ACQUIRE))
+    spin_wait(&spins);
+}
+
+
+void CLHLock_unlock(struct CLHThread *self) {
+  struct CLHNode *released = self->mine;
+  /* the predecessor's node is free now; reuse it for the next lock */
+  self->mine = self->pred;
+  __atomic_store_n(&released->locked, 0, __ATOMIC_RELEASE);
+}
@@ -0,0 +1,61 @@
+/*
+ * NAME: Jonathan Chang
+ * EMAIL: j.a.chang820@gmail.com
+ * ID: 104853981
+ */ 
+
+/** FIFO spin locks for comparing lock handoff cost.
+ *
+ *  TicketLock : two counters, every waiter spins on now_serving.
+ *  MCSLock    : explicit queue, each waiter spins on its own node,
+ *               which the caller supplies and owns.
+ *  CLHLock    : implicit queue, each waiter spins on its predecessor's
+ *               node and adopts that node when it releases the lock.
+ *  A waiter yields its CPU after a bounded number of pauses, so the
+ *  next thread in line can run when there are more threads than CPUs.
+ */
+
+#define CACHE_LINE_SIZE 64
+
+struct TicketLock {
+  unsigned int next_ticket __attribute__((aligned(CACHE_LINE_SIZE)));
+  unsigned int now_serving __attribute__((aligned(CACHE_LINE_SIZE)));
+};
+
+struct MCSNode {
+  struct MCSNode *volatile next;
+  volatile int locked;
+} __attribute__((aligned(CACHE_LINE_SIZE)));
+
+struct MCSLock {
+  struct MCSNode *tail;
+} __attribute__((aligned(CACHE_LINE_SIZE)));
+
+struct CLHNode {
+  volatile int locked;
+} __attribute__((aligned(CACHE_LINE_SIZE)));
+
+struct CLHLock {
+  struct CLHNode *tail;
+} __attribute__((aligned(CACHE_LINE_SIZE)));
+
+/* a thread's handle on a CLHLock; mine is recycled on every release */
+struct CLHThread {
+  struct CLHNode *mine;
+  struct CLHNode *pred;
+};
+
+void TicketLock_init(struct TicketLock *lock);
+void TicketLock_lock(struct TicketLock *lock);
+void TicketLock_unlock(struct TicketLock *lock);
+
+void MCSLock_init(struct MCSLock *lock);
+void MCSLock_lock(struct MCSLock *lock, struct MCSNode *node);
+void MCSLock_unlock(struct MCSLock *lock, struct MCSNode *node);
+
+void CLHLock_init(struct CLHLock *lock);
+void CLHLock_destroy(struct CLHLock *lock);
+void CLHThread_init(struct CLHThread *self);
+void CLHThread_destroy(struct CLHThread *self);
+void CLHLock_lock(struct CLHLock *lock, struct CLHThread *self);
+void CLHLock_unlock(struct CLHThread *self);
@@ -16,50 +16,169 @@
 #include <fcntl.h>
 #include <sched.h>
 #include <getopt.h>
+#include "PerfCounters.h"
+#include "QueueLock.h"
 
 /* program parameter values */
 int opt_yield;
 int num_threads;
 long num_iterations;
-enum sync_option {SYNC_MUTEX, SYNC_SPIN_LOCK, SYNC_COMPARE_SWAP, UNSYNCED} 
-  sync_opt;
+enum sync_option {SYNC_MUTEX, SYNC_SPIN_LOCK, SYNC_COMPARE_SWAP, 
+		 SYNC_PER_THREAD, SYNC_TICKET, SYNC_MCS, SYNC_CLH,
+		 SYNC_PTHREAD_SPIN, SYNC_FETCH_ADD, SYNC_CAS_BACKOFF,
+		 SYNC_SLOPPY, UNSYNCED} sync_opt;
+enum memory_order_option {ORDER_SEQ_CST, ORDER_RELAXED} memory_order;
+int opt_perf;
+long opt_combine;
+int lock_per_op;
+int backoff_max;
+int num_counters;
+double opt_duration;
+long sloppy_threshold;
+long opt_interval;
+enum layout_option {LAYOUT_PACKED, LAYOUT_PADDED} layout;
 
 /* result of operations */
 long long counter = 0;
 int *thread_id;
 
+/* per-thread counter slots, each on its own cache line */
+struct CounterSlot {
+  long long value;
+} __attribute__((aligned(CACHE_LINE_SIZE)));
+struct CounterSlot *slots;
+
+/* independent counters for the false-sharing experiment, either
+   packed eight to a cache line or one per cache line */
+long long *packed_counters;
+struct CounterSlot *padded_counters;
+
 /* sync objects */
 pthread_mutex_t mutex = PTHREAD_MUTEX_INITIALIZER;
 int spinlock = 0;
+struct TicketLock ticket_lock;
+struct MCSLock mcs_lock;
+struct CLHLock clh_lock;
+pthread_spinlock_t pthread_spin;
+
+/* a thread's own queue nodes for the MCS and CLH locks */
+struct LockContext {
+  struct MCSNode mcs_node;
+  struct CLHThread clh;
+};
+
+/* per-thread progress, for fairness of per-operation locking */
+struct ThreadStats {
+  long long ops;
+  long long finish_time;
+  long long ops_at_first_finish;
+  long long cas_failures;
+} __attribute__((aligned(CACHE_LINE_SIZE)));
+struct ThreadStats *stats;
+int first_finished = 0;
+int stop_running = 0;
+
+/* what the reader thread saw of the sloppy counter */
+int workers_done = 0;
+long long reader_samples = 0;
+double reader_staleness_sum = 0;
+long long reader_staleness_max = 0;
+struct timespec start_time;
+
+/* adds since the calling thread last flushed its sloppy counter */
+static __thread long sloppy_adds;
+
+/* failed compare-and-swaps of the calling thread, and its backoff rng */
+static __thread long long cas_failures;
+static __thread unsigned int backoff_seed;
+
+/* hardware counters summed over threads */
+struct PerfCounters perf_total;
+pthread_mutex_t perf_mutex = PTHREAD_MUTEX_INITIALIZER;
 
 /* function declarations */
 static void* add_wrapper(void*);
 void add_compare_and_swap(long long*, long long);
+void add_fetch_seq_cst(long long*, long long);
+void add_fetch_relaxed(long long*, long long);
+void add_backoff_seq_cst(long long*, long long);
+void add_backoff_relaxed(long long*, long long);
+void add_sloppy(long long*, long long);
+static void* read_sloppy_counter(void*);
 void add(long long*, long long);
+void combine_slot(struct CounterSlot*);
+void lock_counter(struct LockContext*);
+void unlock_counter(struct LockContext*);
+void initialize_locks(void);
+void destroy_locks(void);
+void record_finish(int);
+void run_for_duration(int, void (*)(long long*, long long), long long*,
+		      struct LockContext*);
+void sample_throughput(void);
+void average_iterations(void);
+void reduce_slots(void);
+void initialize_counters(void);
+void reduce_counters(void);
 void get_monotonic_time(struct timespec*);
 long long diff_time(struct timespec*, struct timespec*);
 void process_args(int, char**);
 void create_threads(pthread_t*);
 void join_threads(pthread_t*);
+int format_fairness(char*);
+long long total_cas_failures(void);
+int open_csv(const char*);
+void write_csv(int, char*, int);
 void append_csv(long long);
 char* compute_test_name(void);
 
 
 int main(int argc, char *argv[]) {
-  struct timespec start_time, end_time;
+  struct timespec end_time;
   long long diff;
   pthread_t *threads;
+  pthread_t reader;
 
   process_args(argc, argv);
   threads = calloc(num_threads, sizeof(pthread_t));
+  if (posix_memalign((void**) &slots, CACHE_LINE_SIZE,
+		     num_threads * sizeof(struct CounterSlot)) != 0) {
+    fprintf(stderr, "Insufficient memory for per-thread counters.\r\n");
+    exit(2);
+  }
+  memset(slots, 0, num_threads * sizeof(struct CounterSlot));
+  if (posix_memalign((void**) &stats, CACHE_LINE_SIZE,
+		     num_threads * sizeof(struct ThreadStats)) != 0) {
+    fprintf(stderr, "Insufficient memory for thread statistics.\r\n");
+    exit(2);
+  }
+  memset(stats, 0, num_threads * sizeof(struct ThreadStats));
+  initialize_locks();
+  if (num_counters > 0) initialize_counters();
   get_monotonic_time(&start_time);
   create_threads(threads);
+  if (sync_opt == SYNC_SLOPPY &&
+      pthread_create(&reader, NULL, read_sloppy_counter, NULL) != 0) {
+    fprintf(stderr, "Reader thread could not be created.\r\n%s\r\n",
+	    strerror(errno));
+    exit(2);
+  }
+  if (opt_duration > 0) sample_throughput();
   join_threads(threads);
+  if (sync_opt == SYNC_SLOPPY) {
+    __atomic_store_n(&workers_done, 1, __ATOMIC_RELEASE);
+    pthread_join(reader, NULL);
+  }
+  if (sync_opt == SYNC_PER_THREAD || sync_opt == SYNC_SLOPPY) reduce_slots();
+  if (num_counters > 0) reduce_counters();
+  if (opt_duration > 0) average_iterations();
   get_monotonic_time(&end_time);
   diff = diff_time(&start_time, &end_time);
   free(threads);
-  pthread_mutex_destroy(&mutex);
+  free(slots);
+  destroy_locks();
+  pthread_mutex_destroy(&perf_mutex);
   append_csv(diff);
+  free(stats);
 
   exit(0);
 }
@@ -69,37 +188,93 @@ int main(int argc, char *argv[]) {
 static void* add_wrapper(void* thread_id) {
   int n;
   int tid = *((int*)thread_id);
+  struct PerfCounters perf;
+  struct LockContext ctx;
+  if (opt_perf) PerfCounters_start(&perf);
+  if (sync_opt == SYNC_CLH) CLHThread_init(&ctx.clh);
+  backoff_seed = tid + 1;
 
   void (*operation)(long long*, long long);
+  long long *target = &counter;
   if (sync_opt == SYNC_COMPARE_SWAP) {
     operation = &add_compare_and_swap;
   }
+  else if (sync_opt == SYNC_FETCH_ADD) {
+    operation = memory_order == ORDER_RELAXED ?
+      &add_fetch_relaxed : &add_fetch_seq_cst;
+  }
+  else if (sync_opt == SYNC_CAS_BACKOFF) {
+    operation = memory_order == ORDER_RELAXED ?
+      &add_backoff_relaxed : &add_backoff_seq_cst;
+  }
+  else if (sync_opt == SYNC_SLOPPY) {
+    operation = &add_sloppy;
+  }
   else { /* UNSYNCED */
     operation = &add;
   }
-
-  /* lock */
-  if (sync_opt == SYNC_MUTEX) { 
-    pthread_mutex_lock(&mutex);
+  if (sync_opt == SYNC_PER_THREAD || sync_opt == SYNC_SLOPPY) {
+    target = &slots[tid].value; /* private slot, no sharing */
   }
-  else if (sync_opt == SYNC_SPIN_LOCK) {
-    while (__sync_lock_test_and_set(&spinlock, 1));
+  if (num_counters > 0) {
+    if (layout == LAYOUT_PACKED)
+      target = &packed_counters[tid % num_counters];
+    else
+      target = &padded_counters[tid % num_counters].value;
   }
+
+  /* lock */
+  if (!lock_per_op) lock_counter(&ctx);
      
   /* operation */
-  for (n = 0; n < num_iterations; n++) {
-    (*operation)(&counter, 1);
+  if (opt_duration > 0) {
+    run_for_duration(tid, operation, target, &ctx);
+  }
+  else if (sync_opt == SYNC_PER_THREAD && opt_combine > 0) {
+    for (n = 0; n < num_iterations; n++) {
+      (*operation)(target, 1);
+      if ((n + 1) % opt_combine == 0) combine_slot(&slots[tid]);
+    }
+    for (n = 0; n < num_iterations; n++) {
+      (*operation)(target, -1);
+      if ((n + 1) % opt_combine == 0) combine_slot(&slots[tid]);
+    }
   }
-  for (n = 0; n < num_iterations; n++) {
-    (*operation)(&counter, -1);
+  else if (lock_per_op) { /* hand the lock off between every add */
+    for (n = 0; n < num_iterations; n++) {
+      lock_counter(&ctx);
+      (*operation)(target, 1);
+      unlock_counter(&ctx);
+      __atomic_store_n(&stats[tid].ops, n + 1, __ATOMIC_RELAXED);
+    }
+    for (n = 0; n < num_iterations; n++) {
+      lock_counter(&ctx);
+      (*operation)(target, -1);
+      unlock_counter(&ctx);
+      __atomic_store_n(&stats[tid].ops, num_iterations + n + 1,
+		       __ATOMIC_RELAXED);
+    }
+    record_finish(tid);
+  }
+  else {
+    for (n = 0; n < num_iterations; n++) {
+      (*operation)(target, 1);
+    }
+    for (n = 0; n < num_iterations; n++) {
+      (*operation)(target, -1);
+    }
   }
 
   /* unlock */
-  if (sync_opt == SYNC_MUTEX) {
-    pthread_mutex_unlock(&mutex);
-  }
-  else if (sync_opt == SYNC_SPIN_LOCK) {
-    __sync_lock_release(&spinlock);
+  if (!lock_per_op) unlock_counter(&ctx);
+  if (sync_opt == SYNC_CLH) CLHThread_destroy(&ctx.clh);
+  stats[tid].cas_failures = cas_failures;
+
+  if (opt_perf) {
+    PerfCounters_stop(&perf);
+    pthread_mutex_lock(&perf_mutex);
+    PerfCounters_add(&perf_total, &perf);
+    pthread_mutex_unlock(&perf_mutex);
   }
   return NULL;
 }
@@ -123,6 +298,292 @@ void add_compare_and_swap(long long *pointer, long long value) {
   } while(__sync_val_compare_and_swap(pointer, prev, sum) != prev);
 }
 
+/*! Adds to the thread's own slot and moves the slot into the global
+    counter every sloppy_threshold adds, so counter lags the true sum
+    by at most threads * threshold. The slot is stored atomically
+    because the reader thread looks at it to measure that lag. */
+void add_sloppy(long long *pointer, long long value) {
+  long long local = *pointer + value;
+  if (opt_yield)
+    sched_yield();
+  if (++sloppy_adds >= sloppy_threshold) {
+    __atomic_fetch_add(&counter, local, __ATOMIC_RELAXED);
+    local = 0;
+    sloppy_adds = 0;
+  }
+  __atomic_store_n(pointer, local, __ATOMIC_RELAXED);
+}
+
+/*! Samples the approximate global counter while the workers run, and
+    compares it with the exact sum including every thread's pending
+    slot to record how stale a cheap read is. */
+static void* read_sloppy_counter(void* unused) {
+  long long approximate, exact, staleness;
+  int t;
+  (void) unused;
+  while (!__atomic_load_n(&workers_done, __ATOMIC_ACQUIRE)) {
+    approximate = __atomic_load_n(&counter, __ATOMIC_RELAXED);
+    exact = approximate;
+    for (t = 0; t < num_threads; t++)
+      exact += __atomic_load_n(&slots[t].value, __ATOMIC_RELAXED);
+    staleness = llabs(exact - approximate);
+    reader_samples++;
+    reader_staleness_sum += staleness;
+    if (staleness > reader_staleness_max) reader_staleness_max = staleness;
+    sched_yield();
+  }
+  return NULL;
+}
+
+/* The memory order of an __atomic builtin must be a constant, or gcc
+   silently falls back to seq_cst, so each order gets its own copy. */
+
+/*! A single lock xadd on x86; it cannot fail, so there is no retry. */
+void add_fetch_seq_cst(long long *pointer, long long value) {
+  if (opt_yield)
+    sched_yield();
+  __atomic_fetch_add(pointer, value, __ATOMIC_SEQ_CST);
+}
+
+void add_fetch_relaxed(long long *pointer, long long value) {
+  if (opt_yield)
+    sched_yield();
+  __atomic_fetch_add(pointer, value, __ATOMIC_RELAXED);
+}
+
+static inline void cpu_relax(void) {
+#if defined(__x86_64__) || defined(__i386__)
+  __asm__ __volatile__("pause" ::: "memory");
+#else
+  __asm__ __volatile__("" ::: "memory");
+#endif
+}
+
+/*! Waits a random time up to *delay pauses, then doubles *delay up to
+    backoff_max, so colliding threads spread out their next attempts. */
+static void backoff(unsigned int *delay) {
+  unsigned int n, wait;
+  cas_failures++;
+  if (backoff_max == 0) return;
+  wait = rand_r(&backoff_seed) % *delay + 1;
+  for (n = 0; n < wait; n++)
+    cpu_relax();
+  if (*delay < (unsigned int) backoff_max) *delay *= 2;
+}
+
+void add_backoff_seq_cst(long long *pointer, long long value) {
+  unsigned int delay = 1;
+  long long prev = __atomic_load_n(pointer, __ATOMIC_RELAXED);
+  while (1) {
+    if (opt_yield)
+      sched_yield();
+    /* on failure prev is reloaded with the current value */
+    if (__atomic_compare_exchange_n(pointer, &prev, prev + value, 0,
+				    __ATOMIC_SEQ_CST, __ATOMIC_RELAXED))
+      return;
+    backoff(&delay);
+  }
+}
+
+void add_backoff_relaxed(long long *pointer, long long value) {
+  unsigned int delay = 1;
+  long long prev = __atomic_load_n(pointer, __ATOMIC_RELAXED);
+  while (1) {
+    if (opt_yield)
+      sched_yield();
+    if (__atomic_compare_exchange_n(pointer, &prev, prev + value, 0,
+				    __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+      return;
+    backoff(&delay);
+  }
+}
+
+void lock_counter(struct LockContext *ctx) {
+  switch (sync_opt) {
+  case SYNC_MUTEX:
+    pthread_mutex_lock(&mutex);
+    break;
+  case SYNC_SPIN_LOCK:
+    while (__sync_lock_test_and_set(&spinlock, 1));
+    break;
+  case SYNC_TICKET:
+    TicketLock_lock(&ticket_lock);
+    break;
+  case SYNC_MCS:
+    MCSLock_lock(&mcs_lock, &ctx->mcs_node);
+    break;
+  case SYNC_CLH:
+    CLHLock_lock(&clh_lock, &ctx->clh);
+    break;
+  case SYNC_PTHREAD_SPIN:
+    pthread_spin_lock(&pthread_spin);
+    break;
+  default: /* lock-free or unsynced */
+    break;
+  }
+}
+
+void unlock_counter(struct LockContext *ctx) {
+  switch (sync_opt) {
+  case SYNC_MUTEX:
+    pthread_mutex_unlock(&mutex);
+    break;
+  case SYNC_SPIN_LOCK:
+    __sync_lock_release(&spinlock);
+    break;
+  case SYNC_TICKET:
+    TicketLock_unlock(&ticket_lock);
+    break;
+  case SYNC_MCS:
+    MCSLock_unlock(&mcs_lock, &ctx->mcs_node);
+    break;
+  case SYNC_CLH:
+    CLHLock_unlock(&ctx->clh);
+    break;
+  case SYNC_PTHREAD_SPIN:
+    pthread_spin_unlock(&pthread_spin);
+    break;
+  default:
+    break;
+  }
+}
+
+void initialize_locks(void) {
+  TicketLock_init(&ticket_lock);
+  MCSLock_init(&mcs_lock);
+  CLHLock_init(&clh_lock);
+  if (pthread_spin_init(&pthread_spin, PTHREAD_PROCESS_PRIVATE) != 0) {
+    fprintf(stderr, "Spin lock could not be initialized.\r\n");
+    exit(2);
+  }
+}
+
+void destroy_locks(void) {
+  pthread_mutex_destroy(&mutex);
+  pthread_spin_destroy(&pthread_spin);
+  CLHLock_destroy(&clh_lock);
+}
+
+/*! Notes when a thread finished. The first thread to finish also
+    snapshots how far every other thread had gotten by then. */
+void record_finish(int tid) {
+  struct timespec now;
+  int t;
+  get_monotonic_time(&now);
+  stats[tid].finish_time = diff_time(&start_time, &now);
+  if (__sync_bool_compare_and_swap(&first_finished, 0, 1)) {
+    for (t = 0; t < num_threads; t++)
+      stats[t].ops_at_first_finish = 
+	__atomic_load_n(&stats[t].ops, __ATOMIC_RELAXED);
+  }
+}
+
+/*! Adds and subtracts one until the sampler says stop, publishing the
+    thread's running operation count after every pair. */
+void run_for_duration(int tid, void (*operation)(long long*, long long),
+		      long long *target, struct LockContext *ctx) {
+  long long ops = 0;
+  while (!__atomic_load_n(&stop_running, __ATOMIC_ACQUIRE)) {
+    if (lock_per_op) lock_counter(ctx);
+    (*operation)(target, 1);
+    if (lock_per_op) unlock_counter(ctx);
+    if (lock_per_op) lock_counter(ctx);
+    (*operation)(target, -1);
+    if (lock_per_op) unlock_counter(ctx);
+    ops += 2;
+    __atomic_store_n(&stats[tid].ops, ops, __ATOMIC_RELAXED);
+  }
+  if (lock_per_op) record_finish(tid);
+}
+
+/*! Runs on the main thread while the workers add. Every interval it
+    sums the per-thread operation counts and reports the rate since
+    the previous sample, then stops the workers after the duration. */
+void sample_throughput(void) {
+  struct timespec interval, now, last;
+  long long total, last_total = 0, elapsed, since_last;
+  long long duration = (long long) (opt_duration * 1E9);
+  char* test_name = compute_test_name();
+  char output[128];
+  int num_chars, t;
+  int fd = open_csv("lab2_add_series.csv");
+
+  interval.tv_sec = opt_interval / 1000;
+  interval.tv_nsec = (opt_interval % 1000) * 1000000;
+  last = start_time;
+  do {
+    nanosleep(&interval, NULL);
+    get_monotonic_time(&now);
+    total = 0;
+    for (t = 0; t < num_threads; t++)
+      total += __atomic_load_n(&stats[t].ops, __ATOMIC_RELAXED);
+    elapsed = diff_time(&start_time, &now);
+    since_last = diff_time(&last, &now);
+    num_chars = sprintf(output, "%s,%d,%lld,%lld,%.0f\n",
+			test_name,
+			num_threads,
+			elapsed / 1000000,
+			total - last_total,
+			(total - last_total) * 1E9 / since_last);
+    write_csv(fd, output, num_chars);
+    fprintf(stdout, output);
+    last = now;
+    last_total = total;
+  } while (elapsed < duration);
+  __atomic_store_n(&stop_running, 1, __ATOMIC_RELEASE);
+  close(fd);
+}
+
+/*! After a timed run, reports the mean add/subtract pairs per thread
+    as the iteration count. */
+void average_iterations(void) {
+  long long total = 0;
+  int t;
+  for (t = 0; t < num_threads; t++)
+    total += stats[t].ops;
+  num_iterations = total / (2 * num_threads);
+}
+
+/*! Moves a thread's pending slot value into the shared counter. */
+void combine_slot(struct CounterSlot *slot) {
+  __sync_fetch_and_add(&counter, slot->value);
+  slot->value = 0;
+}
+
+void initialize_counters(void) {
+  if (posix_memalign((void**) &packed_counters, CACHE_LINE_SIZE,
+		     num_counters * sizeof(long long)) != 0 ||
+      posix_memalign((void**) &padded_counters, CACHE_LINE_SIZE,
+		     num_counters * sizeof(struct CounterSlot)) != 0) {
+    fprintf(stderr, "Insufficient memory for counters.\r\n");
+    exit(2);
+  }
+  memset(packed_counters, 0, num_counters * sizeof(long long));
+  memset(padded_counters, 0, num_counters * sizeof(struct CounterSlot));
+}
+
+/*! Sums the independent counters into counter, which should be zero. */
+void reduce_counters(void) {
+  int n;
+  for (n = 0; n < num_counters; n++) {
+    if (layout == LAYOUT_PACKED)
+      counter += packed_counters[n];
+    else
+      counter += padded_counters[n].value;
+  }
+  free(packed_counters);
+  free(padded_counters);
+}
+
+/*! Folds every slot into counter once all threads have joined. */
+void reduce_slots(void) {
+  int t;
+  for (t = 0; t < num_threads; t++) {
+    counter += slots[t].value;
+    slots[t].value = 0;
+  }
+}
+
 void get_monotonic_time(struct timespec *tp) {
   if (clock_gettime(CLOCK_MONOTONIC, tp) == -1) {
     switch(errno) {
@@ -158,24 +619,57 @@ long long diff_time(struct timespec* start, struct timespec* end) {
 void process_args(int argc, char* argv[]) {
   int opt, longindex;
 
-  char correct_usage[304] = 
+  char correct_usage[1237] = 
     "Correct usage:\r\n"
-    "/lab2_add --threads=# --iterations=# --sync=m|s|c --yield\r\n"
+    "/lab2_add --threads=# --iterations=# --sync=m|s|c|p|t|q|l|x|a|b|f\r\n"
+    "          --yield --memory-order=relaxed|seq_cst --backoff=#\r\n"
+    "          --counters=# --layout=packed|padded\r\n"
+    "          --duration=# --interval=# --threshold=#\r\n"
     "--thread     : number of threads used to add\r\n"
     "--iterations : number of iterations add will be run\r\n"
-    "--sync       : synchronize with mutex, spinlock, or compare and swap\r\n"
-    "--yield      : whether to yield and increase failure rate\r\n\0";
+    "--sync       : synchronize with a lock (m s t q l x), atomics\r\n"
+    "               (c a b), or per-thread (p) or sloppy (f) counters;\r\n"
+    "               an invalid choice lists them all\r\n"
+    "--combine    : with --sync=p, flush to counter every # operations\r\n"
+    "--lock-per-op: with --sync=m|s, lock around each add, not the loop\r\n"
+    "--memory-order: ordering of --sync=a|b atomics (default seq_cst)\r\n"
+    "--backoff    : with --sync=b, longest backoff in pauses (0 = none)\r\n"
+    "--counters   : thread t adds to counter t % # instead of one counter\r\n"
+    "--layout     : counters share cache lines (packed) or not (padded)\r\n"
+    "--duration   : run for # seconds instead of a fixed iteration count\r\n"
+    "--interval   : with --duration, sample throughput every # ms\r\n"
+    "--threshold  : with --sync=f, adds between flushes to counter\r\n"
+    "--yield      : whether to yield and increase failure rate\r\n"
+    "--perf       : append per-operation hardware counters\r\n\0";
   
-  char sync_usage[101] =
+  char sync_usage[463] =
     "Sync options are:\r\n"
     "m            : mutex\r\n"
     "s            : spin-lock\r\n"
-    "c            : compare and swap\r\n\0";
+    "c            : compare and swap\r\n"
+    "p            : per-thread padded counters\r\n"
+    "t            : ticket lock, per add\r\n"
+    "q            : MCS queue lock, per add\r\n"
+    "l            : CLH queue lock, per add\r\n"
+    "x            : pthread_spinlock_t, per add\r\n"
+    "a            : atomic fetch-and-add\r\n"
+    "b            : compare and swap with exponential backoff\r\n"
+    "f            : sloppy counter, flushed every --threshold adds\r\n\0";
 
   /* default values */
   num_threads = 1;
   num_iterations = 1;
   opt_yield = 0;
+  opt_perf = 0;
+  opt_combine = 0;
+  lock_per_op = 0;
+  memory_order = ORDER_SEQ_CST;
+  backoff_max = 1024;
+  num_counters = 0;
+  layout = LAYOUT_PACKED;
+  opt_duration = 0;
+  sloppy_threshold = 1024;
+  opt_interval = 100;
   sync_opt = UNSYNCED;
 
   while(1) {
@@ -185,6 +679,16 @@ void process_args(int argc, char* argv[]) {
       {"iterations" , required_argument, 0, 'i' },
       {"yield"      , no_argument      , 0, 'y' },
       {"sync"       , required_argument, 0, 's' },
+      {"perf"       , no_argument      , 0, 'p' },
+      {"combine"    , required_argument, 0, 'c' },
+      {"lock-per-op", no_argument      , 0, 'o' },
+      {"memory-order", required_argument, 0, 'r' },
+      {"backoff"    , required_argument, 0, 'b' },
+      {"counters"   , required_argument, 0, 'n' },
+      {"layout"     , required_argument, 0, 'L' },
+      {"duration"   , required_argument, 0, 'd' },
+      {"interval"   , required_argument, 0, 'I' },
+      {"threshold"  , required_argument, 0, 'T' },
       {0            , 0                , 0,  0  }
     };
     opt = getopt_long(argc, argv, "", longopt, &longindex);
@@ -202,6 +706,71 @@ void process_args(int argc, char* argv[]) {
     case 'y':
       opt_yield = 1;
       break;
+    case 'p':
+      opt_perf = 1;
+      PerfCounters_clear(&perf_total);
+      break;
+    case 'c':
+      opt_combine = atol(optarg);
+      break;
+    case 'o':
+      lock_per_op = 1;
+      break;
+    case 'r':
+      if (strcmp(optarg, "relaxed") == 0) {
+	memory_order = ORDER_RELAXED;
+      }
+      else if (strcmp(optarg, "seq_cst") == 0) {
+	memory_order = ORDER_SEQ_CST;
+      }
+      else {
+	fprintf(stderr, "Memory order options are: relaxed, seq_cst\r\n");
+	exit(1);
+      }
+      break;
+    case 'n':
+      num_counters = atoi(optarg);
+      if (num_counters < 1) {
+	fprintf(stderr, "There must be at least one counter.\r\n");
+	exit(1);
+      }
+      break;
+    case 'd':
+      opt_duration = atof(optarg);
+      break;
+    case 'T':
+      sloppy_threshold = atol(optarg);
+      if (sloppy_threshold < 1) {
+	fprintf(stderr, "Threshold must be at least 1.\r\n");
+	exit(1);
+      }
+      break;
+    case 'I':
+      opt_interval = atol(optarg);
+      if (opt_interval < 1) {
+	fprintf(stderr, "Interval must be at least 1 ms.\r\n");
+	exit(1);
+      }
+      break;
+    case 'L':
+      if (strcmp(optarg, "packed") == 0) {
+	layout = LAYOUT_PACKED;
+      }
+      else if (strcmp(optarg, "padded") == 0) {
+	layout = LAYOUT_PADDED;
+      }
+      else {
+	fprintf(stderr, "Layout options are: packed, padded\r\n");
+	exit(1);
+      }
+      break;
+    case 'b':
+      backoff_max = atoi(optarg);
+      if (backoff_max < 0) {
+	fprintf(stderr, "Backoff must not be negative.\r\n");
+	exit(1);
+      }
+      break;
     case 's':
       switch (*optarg) {
       case 'm':
@@ -213,6 +782,30 @@ void process_args(int argc, char* argv[]) {
       case 'c':
 	sync_opt = SYNC_COMPARE_SWAP;
 	break;
+      case 'p':
+	sync_opt = SYNC_PER_THREAD;
+	break;
+      case 't':
+	sync_opt = SYNC_TICKET;
+	break;
+      case 'q':
+	sync_opt = SYNC_MCS;
+	break;
+      case 'l':
+	sync_opt = SYNC_CLH;
+	break;
+      case 'x':
+	sync_opt = SYNC_PTHREAD_SPIN;
+	break;
+      case 'a':
+	sync_opt = SYNC_FETCH_ADD;
+	break;
+      case 'b':
+	sync_opt = SYNC_CAS_BACKOFF;
+	break;
+      case 'f':
+	sync_opt = SYNC_SLOPPY;
+	break;
       default:
 	fprintf(stderr, sync_usage);
 	exit(1);
@@ -230,6 +823,27 @@ void process_args(int argc, char* argv[]) {
     fprintf(stderr, ". %s", correct_usage);
     exit(1);
   }
+  if (num_counters > 0 &&
+      (sync_opt == SYNC_PER_THREAD || sync_opt == SYNC_SLOPPY)) {
+    fprintf(stderr, "--counters cannot be used with --sync=p|f.\r\n");
+    exit(1);
+  }
+  /* queue locks only make sense handed off per add */
+  switch (sync_opt) {
+  case SYNC_TICKET:
+  case SYNC_MCS:
+  case SYNC_CLH:
+  case SYNC_PTHREAD_SPIN:
+    lock_per_op = 1;
+    break;
+  case SYNC_MUTEX:
+  case SYNC_SPIN_LOCK:
+    /* holding the lock for a whole timed run would starve the rest */
+    if (opt_duration > 0) lock_per_op = 1;
+    break;
+  default:
+    lock_per_op = 0;
+  }
 }
 
 
@@ -296,8 +910,39 @@ void join_threads(pthread_t* threads) {
 }
 
 
-void append_csv(long long run_time) {
-  int fd = open("lab2_add.csv", O_CREAT|O_RDWR|O_APPEND, 0644);
+/*! Sums the failed compare-and-swaps over every thread. */
+long long total_cas_failures(void) {
+  long long total = 0;
+  int t;
+  for (t = 0; t < num_threads; t++)
+    total += stats[t].cas_failures;
+  return total;
+}
+
+
+/*! Writes ",first finish,last finish,min progress,max progress", where
+    progress is the operations each thread had completed when the
+    first thread finished. */
+int format_fairness(char *buf) {
+  long long first = stats[0].finish_time, last = stats[0].finish_time;
+  long long least = stats[0].ops_at_first_finish;
+  long long most = stats[0].ops_at_first_finish;
+  int t;
+  for (t = 1; t < num_threads; t++) {
+    if (stats[t].finish_time < first) first = stats[t].finish_time;
+    if (stats[t].finish_time > last) last = stats[t].finish_time;
+    if (stats[t].ops_at_first_finish < least)
+      least = stats[t].ops_at_first_finish;
+    if (stats[t].ops_at_first_finish > most)
+      most = stats[t].ops_at_first_finish;
+  }
+  return sprintf(buf, ",%lld,%lld,%lld,%lld", first, last, least, most);
+}
+
+
+/*! Opens a CSV file for appending, exiting on failure. */
+int open_csv(const char *file_name) {
+  int fd = open(file_name, O_CREAT|O_RDWR|O_APPEND, 0644);
   if (fd == -1) {
     switch(errno) {
     case EACCES:
@@ -332,29 +977,12 @@ void append_csv(long long run_time) {
     }
     exit(2);
   }
+  return fd;
+}
 
-  /* add and minus for each thread for # iterations */
-  char* test_name = compute_test_name();
-  long num_operations = 2 * num_threads * num_iterations; 
-  long long average_time_per_op = run_time / (long long)num_operations;
-  char output[64];
-  int num_chars;
-  num_chars = sprintf(output, "%s,%d,%ld,%ld,%lld,%lld,%ld\n",
-	  test_name,
-	  num_threads,
-	  num_iterations,
-	  num_operations,
-	  run_time,
-	  average_time_per_op,
-	  counter);
-  
-  if (num_chars == -1) {
-    fprintf(stderr, 
-	    "An error occurred in building the string for output.\r\n%s\r\n",
-	    strerror(errno));
-    exit(2);
-  }
 
+/*! Writes one finished line to a CSV file, exiting on failure. */
+void write_csv(int fd, char *output, int num_chars) {
   if (write(fd, output, num_chars) == -1) {
     switch (errno) {
     case EAGAIN:
@@ -391,43 +1019,88 @@ void append_csv(long long run_time) {
     }
     exit(2);
   }
+}
+
+
+void append_csv(long long run_time) {
+  int fd = open_csv("lab2_add.csv");
+
+  /* add and minus for each thread for # iterations */
+  char* test_name = compute_test_name();
+  long num_operations = 2 * num_threads * num_iterations; 
+  long long average_time_per_op = run_time / (long long)num_operations;
+  char output[224];
+  int num_chars;
+  num_chars = sprintf(output, "%s,%d,%ld,%ld,%lld,%lld,%ld",
+	  test_name,
+	  num_threads,
+	  num_iterations,
+	  num_operations,
+	  run_time,
+	  average_time_per_op,
+	  counter);
+  if (lock_per_op)
+    num_chars += format_fairness(output + num_chars);
+  if (sync_opt == SYNC_FETCH_ADD || sync_opt == SYNC_CAS_BACKOFF)
+    num_chars += sprintf(output + num_chars, ",%.4f",
+			 (double) total_cas_failures() / num_operations);
+  if (sync_opt == SYNC_SLOPPY)
+    num_chars += sprintf(output + num_chars, ",%ld,%lld,%.1f,%lld",
+			 sloppy_threshold,
+			 reader_samples,
+			 reader_samples == 0 ? 0 :
+			 reader_staleness_sum / reader_samples,
+			 reader_staleness_max);
+  if (num_counters > 0)
+    num_chars += sprintf(output + num_chars, ",%d,%.0f", num_counters,
+			 num_operations * 1E9 / run_time);
+  if (opt_perf)
+    num_chars += PerfCounters_format(output + num_chars, &perf_total,
+				     num_operations);
+  num_chars += sprintf(output + num_chars, "\n");
+  
+  if (num_chars == -1) {
+    fprintf(stderr, 
+	    "An error occurred in building the string for output.\r\n%s\r\n",
+	    strerror(errno));
+    exit(2);
+  }
+
+  write_csv(fd, output, num_chars);
   fprintf(stdout, output);
   close(fd);
 }
 
 
 char* compute_test_name(void) {
-  static char str_result[16];
-  memset(str_result, 0, 16);
-  if (opt_yield == 0) {
-    switch(sync_opt) {
-    case UNSYNCED:
-      strcpy(str_result, "add-none");
-      break;
-    case SYNC_MUTEX:
-      strcpy(str_result, "add-m");
-      break;
-    case SYNC_SPIN_LOCK:
-      strcpy(str_result, "add-s");
-      break;
-    case SYNC_COMPARE_SWAP:
-      strcpy(str_result, "add-c");
-    }
-  }
-  else { /* opt_yield == 1 */
-    switch(sync_opt) {
-    case UNSYNCED:
-      strcpy(str_result, "add-yield-none");
-      break;
-    case SYNC_MUTEX:
-      strcpy(str_result, "add-yield-m");
-      break;
-    case SYNC_SPIN_LOCK:
-      strcpy(str_result, "add-yield-s");
-      break;
-    case SYNC_COMPARE_SWAP:
-      strcpy(str_result, "add-yield-c");
-    }
-  }
+  static const char *sync_names[] = {
+    [SYNC_MUTEX] = "m",
+    [SYNC_SPIN_LOCK] = "s",
+    [SYNC_COMPARE_SWAP] = "c",
+    [SYNC_PER_THREAD] = "p",
+    [SYNC_TICKET] = "t",
+    [SYNC_MCS] = "q",
+    [SYNC_CLH] = "l",
+    [SYNC_PTHREAD_SPIN] = "x",
+    [SYNC_FETCH_ADD] = "a",
+    [SYNC_CAS_BACKOFF] = "b",
+    [SYNC_SLOPPY] = "f",
+    [UNSYNCED] = "none"
+  };
+  static char str_result[32];
+  memset(str_result, 0, 32);
+  sprintf(str_result, "add-%s%s", opt_yield ? "yield-" : "",
+	  sync_names[sync_opt]);
+  if (sync_opt == SYNC_PER_THREAD && opt_combine > 0)
+    strcat(str_result, "c");
+  if (lock_per_op && (sync_opt == SYNC_MUTEX || sync_opt == SYNC_SPIN_LOCK))
+    strcat(str_result, "-op");
+  if (sync_opt == SYNC_FETCH_ADD || sync_opt == SYNC_CAS_BACKOFF)
+    strcat(str_result,
+	   memory_order == ORDER_RELAXED ? "-relaxed" : "-seq_cst");
+  if (num_counters > 0)
+    strcat(str_result, layout == LAYOUT_PACKED ? "-packed" : "-padded");
+  if (opt_duration > 0)
+    strcat(str_result, "-dur");
   return str_result;
 }
@@ -11,6 +11,34 @@
 #	5. run time (ns)
 #	6. run time per operation (ns)
 #	7. total sum at end of run (should be zero)
+#	with per-add locking (--sync=t|q|l|x, --lock-per-op), fairness follows:
+#	8. time the first thread finished (ns)
+#	9. time the last thread finished (ns)
+#	10. fewest operations any thread had done when the first finished
+#	11. most operations any thread had done when the first finished
+#	with --sync=a|b, one more field follows:
+#	8. failed compare-and-swaps per operation (always 0 for a)
+#	with --sync=f, four more fields follow:
+#	8. adds between flushes to the global counter (threshold)
+#	9. # times the reader thread sampled the global counter
+#	10. mean difference between sampled and exact sum (staleness)
+#	11. largest difference seen
+#	with --counters, two more fields follow:
+#	+1. number of independent counters
+#	+2. throughput (operations per second)
+#	with --perf, per-operation counts follow (after any fields above):
+#	+1. cycles (task-clock ns with software counters)
+#	+2. instructions (-1 with software counters)
+#	+3. LLC misses (page faults with software counters)
+#	+4. context switches
+#	+5. counter source (hw, sw or none)
+#
+# input: lab2_add_series.csv (written by --duration runs)
+#	1. test name
+#	2. # threads
+#	3. time since start (ms)
+#	4. # operations in this interval
+#	5. throughput over this interval (operations per second)
 #
 # output:
 #	lab2_add-1.png ... threads and iterations that run (unprotected) w/o failure
@@ -18,6 +46,12 @@
 #	lab2_add-3.png ... cost per operation vs number of iterations
 #	lab2_add-4.png ... threads and iterations that run (protected) w/o failure
 #	lab2_add-5.png ... cost per operation vs number of threads
+#	lab2_add-6.png ... throughput of per-add lock handoff vs threads
+#	lab2_add-7.png ... fairness of per-add lock handoff vs threads
+#	lab2_add-8.png ... cost of CAS retries vs single-instruction atomics
+#	lab2_add-9.png ... throughput of packed vs padded counters (false sharing)
+#	lab2_add-10.png ... throughput over time of a timed run
+#	lab2_add-11.png ... sloppy counter throughput vs staleness
 #
 # Note:
 #	Managing data is simplified by keeping all of the results in a single
@@ -110,4 +144,154 @@ plot \
      "< grep -e 'add-m,[0-9]*,10000,' lab2_add.csv" using ($2):($6) \
 	title 'mutex' with linespoints lc rgb 'blue', \
      "< grep -e 'add-s,[0-9]*,10000,' lab2_add.csv" using ($2):($6) \
-	title 'spin' with linespoints lc rgb 'orange'
+	title 'spin' with linespoints lc rgb 'orange', \
+     "< grep -e 'add-p,[0-9]*,10000,' lab2_add.csv" using ($2):($6) \
+	title 'per-thread' with linespoints lc rgb 'violet', \
+     "< grep -e 'add-pc,[0-9]*,10000,' lab2_add.csv" using ($2):($6) \
+	title 'per-thread w/combine' with linespoints lc rgb 'brown'
+
+
+set title "Add-6: throughput of per-add lock handoff"
+set xlabel "Threads"
+set logscale x 2
+set xrange [0.75:]
+set ylabel "Throughput (1/s)"
+set logscale y 10
+set output 'lab2_add-6.png'
+set key left bottom
+plot \
+     "< grep -e 'add-m-op,[0-9]*,10000,' lab2_add.csv" \
+	using ($2):(1000000000/($6)) \
+	title 'mutex' with linespoints lc rgb 'blue', \
+     "< grep -e 'add-s-op,[0-9]*,10000,' lab2_add.csv" \
+	using ($2):(1000000000/($6)) \
+	title 'test-and-set' with linespoints lc rgb 'orange', \
+     "< grep -e 'add-x,[0-9]*,10000,' lab2_add.csv" \
+	using ($2):(1000000000/($6)) \
+	title 'pthread spin' with linespoints lc rgb 'red', \
+     "< grep -e 'add-t,[0-9]*,10000,' lab2_add.csv" \
+	using ($2):(1000000000/($6)) \
+	title 'ticket' with linespoints lc rgb 'green', \
+     "< grep -e 'add-q,[0-9]*,10000,' lab2_add.csv" \
+	using ($2):(1000000000/($6)) \
+	title 'MCS' with linespoints lc rgb 'violet', \
+     "< grep -e 'add-l,[0-9]*,10000,' lab2_add.csv" \
+	using ($2):(1000000000/($6)) \
+	title 'CLH' with linespoints lc rgb 'brown'
+
+set title "Add-7: fairness of per-add lock handoff"
+set xlabel "Threads"
+set logscale x 2
+set xrange [0.75:]
+set ylabel "slowest / fastest thread progress"
+unset logscale y
+set yrange [0:1.05]
+set output 'lab2_add-7.png'
+set key left bottom
+# progress of every thread at the moment the first thread finished
+plot \
+     "< grep -e 'add-m-op,[0-9]*,10000,' lab2_add.csv" \
+	using ($2):($10/$11) \
+	title 'mutex' with linespoints lc rgb 'blue', \
+     "< grep -e 'add-s-op,[0-9]*,10000,' lab2_add.csv" \
+	using ($2):($10/$11) \
+	title 'test-and-set' with linespoints lc rgb 'orange', \
+     "< grep -e 'add-x,[0-9]*,10000,' lab2_add.csv" \
+	using ($2):($10/$11) \
+	title 'pthread spin' with linespoints lc rgb 'red', \
+     "< grep -e 'add-t,[0-9]*,10000,' lab2_add.csv" \
+	using ($2):($10/$11) \
+	title 'ticket' with linespoints lc rgb 'green', \
+     "< grep -e 'add-q,[0-9]*,10000,' lab2_add.csv" \
+	using ($2):($10/$11) \
+	title 'MCS' with linespoints lc rgb 'violet', \
+     "< grep -e 'add-l,[0-9]*,10000,' lab2_add.csv" \
+	using ($2):($10/$11) \
+	title 'CLH' with linespoints lc rgb 'brown'
+
+set title "Add-8: CAS retry storms vs atomic fetch-and-add"
+set xlabel "Threads"
+set logscale x 2
+set xrange [0.75:]
+set ylabel "cost per operation(ns)"
+set logscale y 10
+set autoscale y
+set output 'lab2_add-8.png'
+set key left top
+plot \
+     "< grep -e 'add-c,[0-9]*,10000,' lab2_add.csv" using ($2):($6) \
+	title 'CAS' with linespoints lc rgb 'green', \
+     "< grep -e 'add-b-seq_cst,[0-9]*,10000,' lab2_add.csv" using ($2):($6) \
+	title 'CAS w/backoff, seq_cst' with linespoints lc rgb 'blue', \
+     "< grep -e 'add-b-relaxed,[0-9]*,10000,' lab2_add.csv" using ($2):($6) \
+	title 'CAS w/backoff, relaxed' with linespoints lc rgb 'violet', \
+     "< grep -e 'add-a-seq_cst,[0-9]*,10000,' lab2_add.csv" using ($2):($6) \
+	title 'fetch-and-add, seq_cst' with linespoints lc rgb 'red', \
+     "< grep -e 'add-a-relaxed,[0-9]*,10000,' lab2_add.csv" using ($2):($6) \
+	title 'fetch-and-add, relaxed' with linespoints lc rgb 'orange'
+
+set title "Add-9: False sharing, one atomic counter per thread"
+set xlabel "Threads (= counters)"
+set logscale x 2
+set xrange [0.75:]
+set ylabel "Throughput (1/s)"
+set logscale y 10
+set y2label "padded / packed throughput"
+unset logscale y2
+set y2tics
+set ytics nomirror
+set output 'lab2_add-9.png'
+set key left top
+# throughput is the last field of --counters rows
+plot \
+     "< grep -e 'add-a-seq_cst-packed,[0-9]*,100000,' lab2_add.csv" \
+	using ($2):($10) \
+	title 'packed' with linespoints lc rgb 'red', \
+     "< grep -e 'add-a-seq_cst-padded,[0-9]*,100000,' lab2_add.csv" \
+	using ($2):($10) \
+	title 'padded' with linespoints lc rgb 'green', \
+     "< awk -F, '/^add-a-seq_cst-packed,[0-9]*,100000,/ { p[$2] = $NF } \
+	/^add-a-seq_cst-padded,[0-9]*,100000,/ { q[$2] = $NF } \
+	END { for (t in p) if (t in q) print t \",\" q[t] / p[t] }' \
+	lab2_add.csv | sort -n" \
+	using ($1):($2) axes x1y2 \
+	title 'padded / packed' with linespoints lc rgb 'blue'
+
+set title "Add-10: Throughput over time, 8 threads"
+set xlabel "Time (ms)"
+unset logscale x
+set xrange [0:]
+set ylabel "Throughput (1/s)"
+set logscale y 10
+unset y2label
+unset y2tics
+set ytics mirror
+set output 'lab2_add-10.png'
+set key right bottom
+plot \
+     "< grep -e '^add-m-op-dur,8,' lab2_add_series.csv" using ($3):($5) \
+	title 'mutex' with lines lc rgb 'blue', \
+     "< grep -e '^add-c-dur,8,' lab2_add_series.csv" using ($3):($5) \
+	title 'CAS' with lines lc rgb 'green', \
+     "< grep -e '^add-a-seq_cst-dur,8,' lab2_add_series.csv" using ($3):($5) \
+	title 'fetch-and-add' with lines lc rgb 'red'
+
+set title "Add-11: Sloppy counter, throughput vs staleness (8 threads)"
+set xlabel "Flush threshold (adds)"
+set logscale x 2
+set xrange [0.75:]
+set ylabel "Throughput (1/s)"
+set logscale y 10
+set y2label "mean staleness of a read"
+set logscale y2 10
+set y2tics
+set ytics nomirror
+set output 'lab2_add-11.png'
+set key left top
+plot \
+     "< grep -e '^add-f,8,1000000,' lab2_add.csv" \
+	using ($8):(1000000000/($6)) \
+	title 'throughput' with linespoints lc rgb 'blue', \
+     "< grep -e '^add-f,8,1000000,' lab2_add.csv" \
+	using ($8):($10) axes x1y2 \
+	title 'staleness' with linespoints lc rgb 'red'
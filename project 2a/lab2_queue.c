@@ -0,0 +1,586 @@
+/*
+ * NAME: Jonathan Chang
+ * EMAIL: j.a.chang820@gmail.com
+ * ID: 104853981
+ */ 
+
+#include <stdio.h>
+#include <pthread.h>
+#include <time.h>
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <sched.h>
+#include <getopt.h>
+
+/* program parameter values */
+int num_producers;
+int num_consumers;
+long num_iterations;
+long capacity;
+enum sync_option {SYNC_MUTEX, SYNC_SPIN_LOCK, SYNC_LOCK_FREE} sync_opt;
+
+#define CACHE_LINE_SIZE 64
+
+/* Bounded ring buffer. For the lock-free queue every cell carries a
+   sequence number that tells producers and consumers whose turn it is
+   (Vyukov's MPMC queue). The locked queues use the same cells but
+   ignore the sequence and guard head/tail with one lock. */
+struct Cell {
+  long sequence;
+  long long data;
+};
+
+struct Queue {
+  struct Cell *cells;
+  long mask;
+  long tail __attribute__((aligned(CACHE_LINE_SIZE)));  /* enqueue */
+  long head __attribute__((aligned(CACHE_LINE_SIZE)));  /* dequeue */
+  pthread_mutex_t mutex __attribute__((aligned(CACHE_LINE_SIZE)));
+  int spinlock;
+} queue;
+
+/* result of operations */
+long long sum_enqueued = 0;
+long long sum_dequeued = 0;
+long items_dequeued = 0;
+pthread_mutex_t sum_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+/* function declarations */
+static void* produce(void*);
+static void* consume(void*);
+void initialize_queue(void);
+void destroy_queue(void);
+int enqueue(long long);
+int dequeue(long long*);
+int enqueue_lock_free(long long);
+int dequeue_lock_free(long long*);
+void lock_queue(void);
+void unlock_queue(void);
+void get_monotonic_time(struct timespec*);
+long long diff_time(struct timespec*, struct timespec*);
+void process_args(int, char**);
+void create_threads(pthread_t*);
+void join_threads(pthread_t*);
+int open_csv(const char*);
+void write_csv(int, char*, int);
+void append_csv(long long);
+char* compute_test_name(void);
+
+
+int main(int argc, char *argv[]) {
+  struct timespec start_time, end_time;
+  long long diff;
+  pthread_t *threads;
+
+  process_args(argc, argv);
+  threads = calloc(num_producers + num_consumers, sizeof(pthread_t));
+  initialize_queue();
+  get_monotonic_time(&start_time);
+  create_threads(threads);
+  join_threads(threads);
+  get_monotonic_time(&end_time);
+  diff = diff_time(&start_time, &end_time);
+  free(threads);
+  destroy_queue();
+  pthread_mutex_destroy(&sum_mutex);
+  append_csv(diff);
+
+  if (sum_enqueued != sum_dequeued) {
+    fprintf(stderr, "Queue lost or duplicated items.\r\n");
+    exit(2);
+  }
+
+  exit(0);
+}
+
+
+/*! Producer: enqueues 1..iterations, retrying while the queue is full */
+static void* produce(void* unused) {
+  long long n, sum = 0;
+  (void) unused;
+  for (n = 1; n <= num_iterations; n++) {
+    while (enqueue(n) == 0)
+      sched_yield();
+    sum += n;
+  }
+  pthread_mutex_lock(&sum_mutex);
+  sum_enqueued += sum;
+  pthread_mutex_unlock(&sum_mutex);
+  return NULL;
+}
+
+
+/*! Consumer: dequeues until every produced item has been taken */
+static void* consume(void* unused) {
+  long total = num_producers * num_iterations;
+  long long value, sum = 0;
+  (void) unused;
+  while (__atomic_load_n(&items_dequeued, __ATOMIC_RELAXED) < total) {
+    if (dequeue(&value) == 0) {
+      sched_yield();
+      continue;
+    }
+    sum += value;
+    __atomic_fetch_add(&items_dequeued, 1, __ATOMIC_RELAXED);
+  }
+  pthread_mutex_lock(&sum_mutex);
+  sum_dequeued += sum;
+  pthread_mutex_unlock(&sum_mutex);
+  return NULL;
+}
+
+
+void initialize_queue(void) {
+  long n;
+  if (posix_memalign((void**) &queue.cells, CACHE_LINE_SIZE,
+		     capacity * sizeof(struct Cell)) != 0) {
+    fprintf(stderr, "Insufficient memory for queue.\r\n");
+    exit(2);
+  }
+  for (n = 0; n < capacity; n++) {
+    queue.cells[n].sequence = n;
+    queue.cells[n].data = 0;
+  }
+  queue.mask = capacity - 1;
+  queue.head = 0;
+  queue.tail = 0;
+  queue.spinlock = 0;
+  pthread_mutex_init(&queue.mutex, NULL);
+}
+
+
+void destroy_queue(void) {
+  pthread_mutex_destroy(&queue.mutex);
+  free(queue.cells);
+}
+
+
+void lock_queue(void) {
+  if (sync_opt == SYNC_MUTEX)
+    pthread_mutex_lock(&queue.mutex);
+  else
+    while (__sync_lock_test_and_set(&queue.spinlock, 1));
+}
+
+
+void unlock_queue(void) {
+  if (sync_opt == SYNC_MUTEX)
+    pthread_mutex_unlock(&queue.mutex);
+  else
+    __sync_lock_release(&queue.spinlock);
+}
+
+
+/*! Returns 1 if value was added, 0 if the queue was full */
+int enqueue(long long value) {
+  int added = 0;
+  if (sync_opt == SYNC_LOCK_FREE)
+    return enqueue_lock_free(value);
+  lock_queue();
+  if (queue.tail - queue.head < capacity) {
+    queue.cells[queue.tail & queue.mask].data = value;
+    queue.tail++;
+    added = 1;
+  }
+  unlock_queue();
+  return added;
+}
+
+
+/*! Returns 1 if a value was removed into *value, 0 if the queue was empty */
+int dequeue(long long *value) {
+  int removed = 0;
+  if (sync_opt == SYNC_LOCK_FREE)
+    return dequeue_lock_free(value);
+  lock_queue();
+  if (queue.tail != queue.head) {
+    *value = queue.cells[queue.head & queue.mask].data;
+    queue.head++;
+    removed = 1;
+  }
+  unlock_queue();
+  return removed;
+}
+
+
+/*! A producer claims position pos with a CAS on tail once the cell's
+    sequence says the slot is free (sequence == pos), fills it, then
+    publishes it by setting sequence to pos + 1. */
+int enqueue_lock_free(long long value) {
+  struct Cell *cell;
+  long pos = __atomic_load_n(&queue.tail, __ATOMIC_RELAXED);
+  long seq, dif;
+  while (1) {
+    cell = &queue.cells[pos & queue.mask];
+    seq = __atomic_load_n(&cell->sequence, __ATOMIC_ACQUIRE);
+    dif = seq - pos;
+    if (dif == 0) {
+      if (__atomic_compare_exchange_n(&queue.tail, &pos, pos + 1, 1,
+				      __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+	break;
+    }
+    else if (dif < 0) {  /* the lap behind has not been consumed: full */
+      return 0;
+    }
+    else {               /* another producer took pos, catch up */
+      pos = __atomic_load_n(&queue.tail, __ATOMIC_RELAXED);
+    }
+  }
+  cell->data = value;
+  __atomic_store_n(&cell->sequence, pos + 1, __ATOMIC_RELEASE);
+  return 1;
+}
+
+
+/*! A consumer claims position pos once the cell's sequence says it has
+    been filled (sequence == pos + 1), reads it, then frees it for the
+    next lap by setting sequence to pos + capacity. */
+int dequeue_lock_free(long long *value) {
+  struct Cell *cell;
+  long pos = __atomic_load_n(&queue.head, __ATOMIC_RELAXED);
+  long seq, dif;
+  while (1) {
+    cell = &queue.cells[pos & queue.mask];
+    seq = __atomic_load_n(&cell->sequence, __ATOMIC_ACQUIRE);
+    dif = seq - (pos + 1);
+    if (dif == 0) {
+      if (__atomic_compare_exchange_n(&queue.head, &pos, pos + 1, 1,
+				      __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+	break;
+    }
+    else if (dif < 0) {  /* nothing produced here yet: empty */
+      return 0;
+    }
+    else {
+      pos = __atomic_load_n(&queue.head, __ATOMIC_RELAXED);
+    }
+  }
+  *value = cell->data;
+  __atomic_store_n(&cell->sequence, pos + queue.mask + 1, __ATOMIC_RELEASE);
+  return 1;
+}
+
+
+void get_monotonic_time(struct timespec *tp) {
+  if (clock_gettime(CLOCK_MONOTONIC, tp) == -1) {
+    switch(errno) {
+    case EFAULT:
+      fprintf(stderr, 
+	      "Clock points outside the accessible address space.\r\n");
+      break;
+    case EINVAL:
+      fprintf(stderr, 
+	      "Monotonic clock is not supported on this system.\r\n");
+      break;
+    case EPERM:
+      fprintf(stderr,
+	      "No permission to set the clock.\r\n");
+      break;
+    default:
+      fprintf(stderr,
+	      "Miscellaneous clock error.\r\n%s\r\n",
+	      strerror(errno));
+    }
+    exit(2);
+  }
+}
+
+
+long long diff_time(struct timespec* start, struct timespec* end) {
+  long long sec_diff = (long long)1E9 * (end->tv_sec - start->tv_sec);
+  long long nsec_diff = (long long) (end->tv_nsec - start->tv_nsec);
+  return sec_diff + nsec_diff;
+}
+
+
+void process_args(int argc, char* argv[]) {
+  int opt, longindex;
+
+  char correct_usage[391] = 
+    "Correct usage:\r\n"
+    "/lab2_queue --producers=# --consumers=# --iterations=# --sync=m|s|v "
+    "--capacity=#\r\n"
+    "--producers  : number of threads enqueuing\r\n"
+    "--consumers  : number of threads dequeuing\r\n"
+    "--iterations : number of items each producer enqueues\r\n"
+    "--sync       : synchronize with mutex, spinlock, or lock-free queue\r\n"
+    "--capacity   : number of slots in the ring buffer, a power of 2 "
+    "(default 1024)\r\n\0";
+  
+  char sync_usage[109] =
+    "Sync options are:\r\n"
+    "m            : mutex\r\n"
+    "s            : spin-lock\r\n"
+    "v            : lock-free (Vyukov) queue\r\n\0";
+
+  /* default values */
+  num_producers = 1;
+  num_consumers = 1;
+  num_iterations = 1;
+  capacity = 1024;
+  sync_opt = SYNC_MUTEX;
+
+  while(1) {
+    longindex =0;
+    static struct option longopt[] = {
+      {"producers"  , required_argument, 0, 'p' },
+      {"consumers"  , required_argument, 0, 'c' },
+      {"iterations" , required_argument, 0, 'i' },
+      {"sync"       , required_argument, 0, 's' },
+      {"capacity"   , required_argument, 0, 'C' },
+      {0            , 0                , 0,  0  }
+    };
+    opt = getopt_long(argc, argv, "", longopt, &longindex);
+
+    if (opt == -1)
+      break;
+
+    switch (opt) {
+    case 'p':
+      num_producers = atoi(optarg);
+      break;
+    case 'c':
+      num_consumers = atoi(optarg);
+      break;
+    case 'i':
+      num_iterations = atol(optarg);
+      break;
+    case 's':
+      switch (*optarg) {
+      case 'm':
+	sync_opt = SYNC_MUTEX;
+	break;
+      case 's':
+	sync_opt = SYNC_SPIN_LOCK;
+	break;
+      case 'v':
+	sync_opt = SYNC_LOCK_FREE;
+	break;
+      default:
+	fprintf(stderr, sync_usage);
+	exit(1);
+      }
+      break;
+    case 'C':
+      capacity = atol(optarg);
+      /* positions are mapped to cells with a mask */
+      if (capacity < 2 || (capacity & (capacity - 1)) != 0) {
+	fprintf(stderr, "Capacity must be a power of 2.\r\n");
+	exit(1);
+      }
+      break;
+    default:
+      fprintf(stderr, correct_usage);
+      exit(1);
+    }
+  }
+  if (optind < argc) {
+    fprintf(stderr, "Invalid arguments: ");
+    while (optind < argc)
+      fprintf(stderr, "%s ", argv[optind++]);
+    fprintf(stderr, ". %s", correct_usage);
+    exit(1);
+  }
+  if (num_producers < 1 || num_consumers < 1) {
+    fprintf(stderr, "Need at least one producer and one consumer.\r\n");
+    exit(1);
+  }
+}
+
+
+/*! Producers are threads 0..producers-1, consumers follow them */
+void create_threads(pthread_t* threads) {
+  int t;
+  int num_threads = num_producers + num_consumers;
+  void* (*routine)(void*);
+  for (t = 0; t < num_threads; t++) {
+    routine = (t < num_producers) ? produce : consume;
+    if (pthread_create(&threads[t], NULL, routine, NULL) != 0) {
+      fprintf(stderr, "On thread %d: ", t+1);
+      switch (errno) {
+      case EAGAIN:
+	fprintf(stderr, 
+		"Insufficient resources to create another thread.\r\n");
+	break;
+      case EINVAL:
+	fprintf(stderr,
+		"Invalid settings in attr.\r\n");
+	break;
+      case EPERM:
+	fprintf(stderr,
+		"No permission to set parameters specificed in attr.\r\n");
+	break;
+      default:
+	fprintf(stderr,
+		"Miscellaneous thread create error.\r\n%s\r\n",
+		strerror(errno));
+      }
+      exit(2);
+    }
+  }
+}
+
+
+void join_threads(pthread_t* threads) {
+  int t;
+  int num_threads = num_producers + num_consumers;
+  for (t = 0; t < num_threads; t++) {
+    if (pthread_join(threads[t], NULL) != 0) {
+      fprintf(stderr, "On thread %d: ", t+1);
+      switch (errno) {
+      case EDEADLK:
+	fprintf(stderr, 
+		"A deadlock was detected.\r\n");
+	break;
+      case EINVAL:
+	fprintf(stderr,
+		"Thread %d is not a joinable thread.\r\n", t);
+	break;
+      case ESRCH:
+	fprintf(stderr,
+		"No thread with the ID %d could be found.\r\n", t);
+	break;
+      default:
+	fprintf(stderr,
+		"Miscellaneous thread join error.\r\n%s\r\n",
+		strerror(errno));
+      }
+      exit(2);
+    }
+  }
+}
+
+
+int open_csv(const char *file_name) {
+  int fd = open(file_name, O_CREAT|O_RDWR|O_APPEND, 0644);
+  if (fd == -1) {
+    switch(errno) {
+    case EACCES:
+      fprintf(stderr,
+	      "The requested access to file is not allowed.\r\n");
+      break;
+    case EDQUOT:
+      fprintf(stderr,
+	      "The quota of disk blocks on filesystem has been "
+	      "exhausted.\r\n");
+      break;
+    case EFAULT:
+      fprintf(stderr,
+	      "The file points outside your accessible address space.\r\n");
+      break;
+    case EINTR:
+      fprintf(stderr,
+	      "The call was interrupted by a signal handler.\r\n");
+      break;
+    case EOVERFLOW:
+      fprintf(stderr,
+	      "The file is too large to be opened.\r\n");
+      break;
+    case EROFS:
+      fprintf(stderr,
+	      "The file is read-only.\r\n");
+      break;
+    default:
+      fprintf(stderr,
+	      "Miscellaneous file error.\r\n%s\r\n",
+	      strerror(errno));
+    }
+    exit(2);
+  }
+  return fd;
+}
+
+
+/*! Writes one finished line to a CSV file, exiting on failure. */
+void write_csv(int fd, char *output, int num_chars) {
+  if (write(fd, output, num_chars) == -1) {
+    switch (errno) {
+    case EAGAIN:
+      fprintf(stderr,
+	      "The file descriptor for writing has been marked "
+	      "nonblocking.\r\n");
+      break;
+    case EBADF:
+      fprintf(stderr,
+	      "The file descriptor is not valid or open for writing.\r\n");
+      break;
+    case EDQUOT:
+      fprintf(stderr,
+	      "The quota of disk blocks on filesystem has been "
+	      "exhausted.\r\n");
+      break;
+    case EFAULT:
+      fprintf(stderr,
+	      "Buffer is outside accessible address space.\r\n");
+      break;
+    case EINTR:
+      fprintf(stderr,
+	      "The call was interrupted by a signal before any data was "
+	      "written.\r\n");
+      break;
+    case EINVAL:
+      fprintf(stderr,
+	      "The file is unsuitable for writing, or is misaligned.\r\n");
+      break;
+    default:
+      fprintf(stderr,
+	      "Miscellaneous writing error.\r\n%s\r\n",
+	      strerror(errno));
+    }
+    exit(2);
+  }
+}
+
+
+
+
+void append_csv(long long run_time) {
+  int fd = open_csv("lab2_queue.csv");
+
+  /* one enqueue and one dequeue per item; a correct queue hands every
+     item to exactly one consumer, so the sums match */
+  char* test_name = compute_test_name();
+  long num_operations = 2 * num_producers * num_iterations; 
+  long long average_time_per_op = run_time / (long long)num_operations;
+  char output[128];
+  int num_chars;
+  num_chars = sprintf(output, "%s,%d,%d,%ld,%ld,%ld,%lld,%lld,%lld\n",
+	  test_name,
+	  num_producers,
+	  num_consumers,
+	  num_iterations,
+	  capacity,
+	  num_operations,
+	  run_time,
+	  average_time_per_op,
+	  sum_enqueued - sum_dequeued);
+  
+  if (num_chars == -1) {
+    fprintf(stderr, 
+	    "An error occurred in building the string for output.\r\n%s\r\n",
+	    strerror(errno));
+    exit(2);
+  }
+
+  write_csv(fd, output, num_chars);
+  fprintf(stdout, output);
+  close(fd);
+}
+
+
+char* compute_test_name(void) {
+  static const char *sync_names[] = {
+    [SYNC_MUTEX] = "m",
+    [SYNC_SPIN_LOCK] = "s",
+    [SYNC_LOCK_FREE] = "v"
+  };
+  static char str_result[16];
+  memset(str_result, 0, 16);
+  sprintf(str_result, "queue-%s", sync_names[sync_opt]);
+  return str_result;
+}
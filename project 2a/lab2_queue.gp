@@ -0,0 +1,65 @@
+#! /usr/bin/gnuplot
+#
+# purpose:
+#	 generate data reduction graphs for the producer/consumer queue
+#
+# input: lab2_queue.csv
+#	1. test name (queue-m, queue-s or queue-v)
+#	2. # producer threads
+#	3. # consumer threads
+#	4. # items enqueued per producer
+#	5. # slots in the ring buffer
+#	6. # operations (one enqueue and one dequeue per item)
+#	7. run time (ns)
+#	8. run time per operation (ns)
+#	9. enqueued sum minus dequeued sum (should be zero)
+#
+# output:
+#	lab2_queue-1.png ... throughput vs threads, equal producers and consumers
+#	lab2_queue-2.png ... throughput vs ring buffer capacity
+#
+# Note:
+#	Every run appends to the same file, so each plot filters its rows
+#	with grep (test name) and awk (thread counts, capacity).
+#
+
+# general plot parameters
+set terminal png
+set datafile separator ","
+
+# throughput with as many producers as consumers
+set title "Queue-1: Throughput vs threads (producers = consumers)"
+set xlabel "Producers (and consumers)"
+set logscale x 2
+set xrange [0.75:]
+set ylabel "Throughput (operations/sec)"
+set logscale y 10
+set output 'lab2_queue-1.png'
+set key right top
+plot \
+     "< grep queue-m lab2_queue.csv | awk -F, '$2 == $3 && $5 == 1024'" \
+	using ($2):(1000000000/($8)) \
+	title 'mutex' with linespoints lc rgb 'red', \
+     "< grep queue-s lab2_queue.csv | awk -F, '$2 == $3 && $5 == 1024'" \
+	using ($2):(1000000000/($8)) \
+	title 'spin-lock' with linespoints lc rgb 'green', \
+     "< grep queue-v lab2_queue.csv | awk -F, '$2 == $3 && $5 == 1024'" \
+	using ($2):(1000000000/($8)) \
+	title 'lock-free' with linespoints lc rgb 'blue'
+
+# a small ring buffer makes producers wait on a full queue
+set title "Queue-2: Throughput vs capacity (4 producers, 4 consumers)"
+set xlabel "Ring buffer capacity (slots)"
+set logscale x 2
+set xrange [1:]
+set ylabel "Throughput (operations/sec)"
+set logscale y 10
+set output 'lab2_queue-2.png'
+set key left top
+plot \
+     "< grep 'queue-m,4,4,' lab2_queue.csv" using ($5):(1000000000/($8)) \
+	title 'mutex' with linespoints lc rgb 'red', \
+     "< grep 'queue-s,4,4,' lab2_queue.csv" using ($5):(1000000000/($8)) \
+	title 'spin-lock' with linespoints lc rgb 'green', \
+     "< grep 'queue-v,4,4,' lab2_queue.csv" using ($5):(1000000000/($8)) \
+	title 'lock-free' with linespoints lc rgb 'blue'
@@ -0,0 +1,102 @@
+/*
+ * NAME: Jonathan Chang
+ * EMAIL: j.a.chang820@gmail.com
+ * ID: 104853981
+ */ 
+
+#include <unistd.h>
+#include <errno.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+#include "AdaptiveLock.h"
+
+
+static void futex_wait(int *addr, int val) {
+  if (syscall(SYS_futex, addr, FUTEX_WAIT_PRIVATE, val, NULL, NULL, 0) == -1) {
+    switch(errno) {
+    case EAGAIN: /* lock word changed before we slept */
+    case EINTR:
+      break;
+    case EINVAL:
+      fprintf(stderr,
+	      "Futex address is misaligned or operation is invalid.\r\n");
+      exit(2);
+    case ENOSYS:
+      fprintf(stderr,
+	      "Futex is not supported on this system.\r\n");
+      exit(2);
+    default:
+      fprintf(stderr,
+	      "Miscellaneous futex wait error.\r\n%s\r\n",
+	      strerror(errno));
+      exit(2);
+    }
+  }
+}
+
+
+static void futex_wake(int *addr) {
+  if (syscall(SYS_futex, addr, FUTEX_WAKE_PRIVATE, 1, NULL, NULL, 0) == -1) {
+    fprintf(stderr,
+	    "Miscellaneous futex wake error.\r\n%s\r\n",
+	    strerror(errno));
+    exit(2);
+  }
+}
+
+
+static inline void cpu_relax(void) {
+#if defined(__x86_64__) || defined(__i386__)
+  __asm__ __volatile__("pause" ::: "memory");
+#else
+  __asm__ __volatile__("" ::: "memory");
+#endif
+}
+
+
+/*! Moves the budget 1/8 of the way toward the latest sample. */
+static void adapt_budget(struct AdaptiveLock *lock, int sample) {
+  int budget = lock->spin_budget;
+  budget += (sample - budget) / 8;
+  if (budget < ADAPTIVE_MIN_SPIN) budget = ADAPTIVE_MIN_SPIN;
+  if (budget > ADAPTIVE_MAX_SPIN) budget = ADAPTIVE_MAX_SPIN;
+  lock->spin_budget = budget;
+}
+
+
+void AdaptiveLock_init(struct AdaptiveLock *lock) {
+  lock->state = 0;
+  lock->spin_budget = ADAPTIVE_MIN_SPIN * 4;
+}
+
+
+void AdaptiveLock_lock(struct AdaptiveLock *lock) {
+  int budget = lock->spin_budget;
+  int spins;
+
+  /* spin while the holder is expected to release soon */
+  for (spins = 0; spins < budget; spins++) {
+    if (lock->state == 0 &&
+	__sync_bool_compare_and_swap(&lock->state, 0, 1)) {
+      /* the hold we waited on fit inside the budget, so keep
+	 roughly twice that much headroom for the next waiter */
+      adapt_budget(lock, spins * 2);
+      return;
+    }
+    cpu_relax();
+  }
+
+  /* hold outlasted the budget: mark contended and park */
+  while (__atomic_exchange_n(&lock->state, 2, __ATOMIC_ACQUIRE) != 0)
+    futex_wait(&lock->state, 2);
+  adapt_budget(lock, budget / 2);
+}
+
+
+void AdaptiveLock_unlock(struct AdaptiveLock *lock) {
+  if (__atomic_exchange_n(&lock->state, 0, __ATOMIC_RELEASE) == 2)
+    futex_wake(&lock->state);
+}
@@ -0,0 +1,30 @@
+/*
+ * NAME: Jonathan Chang
+ * EMAIL: j.a.chang820@gmail.com
+ * ID: 104853981
+ */ 
+
+/** Spin-then-park lock built directly on futex(2).
+ *
+ *  state is 0 when unlocked, 1 when locked and 2 when locked with
+ *  (possibly) parked waiters. A thread first spins for at most
+ *  spin_budget iterations, then sleeps in the kernel until woken.
+ *
+ *  spin_budget is tuned per lock from how long recent acquisitions
+ *  had to wait for the holder: short holds grow the budget so the
+ *  next waiter avoids the syscall, long holds shrink it so waiters
+ *  park early instead of burning the CPU.
+ */
+
+#define ADAPTIVE_MIN_SPIN 16
+#define ADAPTIVE_MAX_SPIN 4096
+#define CACHE_LINE_SIZE 64
+
+struct AdaptiveLock {
+  int state;
+  int spin_budget;
+} __attribute__((aligned(CACHE_LINE_SIZE)));
+
+void AdaptiveLock_init(struct AdaptiveLock *lock);
+void AdaptiveLock_lock(struct AdaptiveLock *lock);
+void AdaptiveLock_unlock(struct AdaptiveLock *lock);
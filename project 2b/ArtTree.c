@@ -0,0 +1,603 @@
+/*
+ * NAME: Jonathan Chang
+ * EMAIL: j.a.chang820@gmail.com
+ * ID: 104853981
+ */ 
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sched.h>
+#include "SortedList.h"
+#include "ListBackend.h"
+#include "ArtTree.h"
+
+#define OLC_OBSOLETE 1
+#define OLC_LOCKED 2
+#define ART_RESTART -2
+
+static struct ArtNode **roots;     /* a Node256 per sublist, never replaced */
+static struct ArtNode *retired_nodes;
+
+
+static struct ArtNode *new_node(enum art_type type) {
+  static const size_t sizes[] = {
+    [ART_NODE4] = sizeof(struct ArtNode4),
+    [ART_NODE16] = sizeof(struct ArtNode16),
+    [ART_NODE48] = sizeof(struct ArtNode48),
+    [ART_NODE256] = sizeof(struct ArtNode256)
+  };
+  struct ArtNode *node = calloc(1, sizes[type]);
+  if (node == NULL) {
+    fprintf(stderr, "Insufficient memory for radix tree node.\r\n");
+    exit(2);
+  }
+  node->type = type;
+  return node;
+}
+
+
+static inline int is_leaf(struct ArtNode *node) {
+  return ((uintptr_t) node & 1) != 0;
+}
+
+
+static inline struct ArtNode *make_leaf(long n) {
+  return (struct ArtNode*) (((uintptr_t) n << 1) | 1);
+}
+
+
+static inline long leaf_value(struct ArtNode *leaf) {
+  return (long) ((uintptr_t) leaf >> 1);
+}
+
+
+/*! Notes the version of a live, unlocked node; 0 otherwise. */
+static int read_lock(struct ArtNode *node, uint64_t *version) {
+  uint64_t v = __atomic_load_n(&node->version, __ATOMIC_ACQUIRE);
+  if (v & (OLC_LOCKED | OLC_OBSOLETE)) {
+    if (v & OLC_LOCKED) sched_yield();
+    return 0;
+  }
+  *version = v;
+  return 1;
+}
+
+
+static int validate(struct ArtNode *node, uint64_t version) {
+  __atomic_thread_fence(__ATOMIC_ACQUIRE);
+  return __atomic_load_n(&node->version, __ATOMIC_RELAXED) == version;
+}
+
+
+static int upgrade(struct ArtNode *node, uint64_t version) {
+  return __atomic_compare_exchange_n(&node->version, &version,
+				     version + OLC_LOCKED, 0,
+				     __ATOMIC_ACQUIRE, __ATOMIC_RELAXED);
+}
+
+
+static void write_unlock(struct ArtNode *node) {
+  __atomic_fetch_add(&node->version, OLC_LOCKED, __ATOMIC_RELEASE);
+}
+
+
+/*! Unlocks a node that has been replaced and keeps it until destroy,
+    since readers may still be looking at it. */
+static void write_unlock_obsolete(struct ArtNode *node) {
+  struct ArtNode *head = __atomic_load_n(&retired_nodes, __ATOMIC_RELAXED);
+  __atomic_fetch_add(&node->version, OLC_LOCKED | OLC_OBSOLETE,
+		     __ATOMIC_RELEASE);
+  do {
+    node->retired = head;
+  } while (!__atomic_compare_exchange_n(&retired_nodes, &head, node, 1,
+					__ATOMIC_RELEASE, __ATOMIC_RELAXED));
+}
+
+
+/*! The len bytes of key starting at depth become node's prefix. */
+static void set_prefix(struct ArtNode *node, const char *key, uint32_t depth,
+		       uint32_t len) {
+  uint32_t i;
+  node->prefix_key = key;
+  node->prefix_len = len;
+  for (i = 0; i < len && i < ART_MAX_PREFIX; i++)
+    node->prefix[i] = key[depth + i];
+}
+
+
+/*! Number of leading bytes of node's prefix (len bytes, from depth)
+    that key matches. Stops at the end of either string, so a torn
+    read cannot run off a key. */
+static uint32_t prefix_mismatch(struct ArtNode *node, uint32_t len,
+				const char *key, uint32_t depth) {
+  const char *full = node->prefix_key;
+  unsigned char c;
+  uint32_t i;
+  for (i = 0; i < len; i++) {
+    if (key[depth + i] == '\0') return i;
+    if (i < ART_MAX_PREFIX)
+      c = node->prefix[i];
+    else if (full == NULL || full[depth + i] == '\0')
+      return i;
+    else
+      c = full[depth + i];
+    if (c != (unsigned char) key[depth + i]) return i;
+  }
+  return len;
+}
+
+
+static struct ArtNode *find_child(struct ArtNode *node, unsigned char byte) {
+  struct ArtNode4 *n4;
+  struct ArtNode16 *n16;
+  struct ArtNode48 *n48;
+  int i, count = node->count, idx;
+  switch (node->type) {
+  case ART_NODE4:
+    n4 = (struct ArtNode4*) node;
+    for (i = 0; i < count && i < 4; i++)
+      if (n4->keys[i] == byte) return n4->children[i];
+    return NULL;
+  case ART_NODE16:
+    n16 = (struct ArtNode16*) node;
+    for (i = 0; i < count && i < 16; i++)
+      if (n16->keys[i] == byte) return n16->children[i];
+    return NULL;
+  case ART_NODE48:
+    n48 = (struct ArtNode48*) node;
+    idx = n48->index[byte];
+    return (idx > 0 && idx <= 48) ? n48->children[idx - 1] : NULL;
+  default:
+    return ((struct ArtNode256*) node)->children[byte];
+  }
+}
+
+
+/*! Slot holding the child for byte in a locked node. */
+static struct ArtNode **child_slot(struct ArtNode *node, unsigned char byte) {
+  struct ArtNode4 *n4;
+  struct ArtNode16 *n16;
+  int i;
+  switch (node->type) {
+  case ART_NODE4:
+    n4 = (struct ArtNode4*) node;
+    for (i = 0; i < node->count; i++)
+      if (n4->keys[i] == byte) return &n4->children[i];
+    return NULL;
+  case ART_NODE16:
+    n16 = (struct ArtNode16*) node;
+    for (i = 0; i < node->count; i++)
+      if (n16->keys[i] == byte) return &n16->children[i];
+    return NULL;
+  case ART_NODE48:
+    return &((struct ArtNode48*) node)->children
+      [((struct ArtNode48*) node)->index[byte] - 1];
+  default:
+    return &((struct ArtNode256*) node)->children[byte];
+  }
+}
+
+
+static int is_full(struct ArtNode *node) {
+  static const int capacity[] = {4, 16, 48, 257};
+  return node->count >= capacity[node->type];
+}
+
+
+/*! Inserts into a sorted byte/child array with room for one more. */
+static void add_sorted(unsigned char *keys, struct ArtNode **children,
+		       int count, unsigned char byte, struct ArtNode *child) {
+  int pos = 0;
+  while (pos < count && keys[pos] < byte) pos++;
+  memmove(keys + pos + 1, keys + pos, count - pos);
+  memmove(children + pos + 1, children + pos,
+	  (count - pos) * sizeof(struct ArtNode*));
+  keys[pos] = byte;
+  children[pos] = child;
+}
+
+
+/*! Adds a child to a locked node that is not full. */
+static void add_child(struct ArtNode *node, unsigned char byte,
+		      struct ArtNode *child) {
+  struct ArtNode4 *n4;
+  struct ArtNode16 *n16;
+  struct ArtNode48 *n48;
+  int slot;
+  switch (node->type) {
+  case ART_NODE4:
+    n4 = (struct ArtNode4*) node;
+    add_sorted(n4->keys, n4->children, node->count, byte, child);
+    break;
+  case ART_NODE16:
+    n16 = (struct ArtNode16*) node;
+    add_sorted(n16->keys, n16->children, node->count, byte, child);
+    break;
+  case ART_NODE48:
+    n48 = (struct ArtNode48*) node;
+    for (slot = 0; n48->children[slot] != NULL; slot++)
+      ;
+    n48->children[slot] = child;
+    n48->index[byte] = slot + 1;
+    break;
+  default:
+    ((struct ArtNode256*) node)->children[byte] = child;
+  }
+  node->count++;
+}
+
+
+/*! Removes the child for byte from a locked node. */
+static void remove_child(struct ArtNode *node, unsigned char byte) {
+  struct ArtNode4 *n4;
+  struct ArtNode16 *n16;
+  struct ArtNode48 *n48;
+  int pos;
+  switch (node->type) {
+  case ART_NODE4:
+    n4 = (struct ArtNode4*) node;
+    for (pos = 0; n4->keys[pos] != byte; pos++)
+      ;
+    memmove(n4->keys + pos, n4->keys + pos + 1, node->count - pos - 1);
+    memmove(n4->children + pos, n4->children + pos + 1,
+	    (node->count - pos - 1) * sizeof(struct ArtNode*));
+    break;
+  case ART_NODE16:
+    n16 = (struct ArtNode16*) node;
+    for (pos = 0; n16->keys[pos] != byte; pos++)
+      ;
+    memmove(n16->keys + pos, n16->keys + pos + 1, node->count - pos - 1);
+    memmove(n16->children + pos, n16->children + pos + 1,
+	    (node->count - pos - 1) * sizeof(struct ArtNode*));
+    break;
+  case ART_NODE48:
+    n48 = (struct ArtNode48*) node;
+    n48->children[n48->index[byte] - 1] = NULL;
+    n48->index[byte] = 0;
+    break;
+  default:
+    ((struct ArtNode256*) node)->children[byte] = NULL;
+  }
+  node->count--;
+}
+
+
+/*! Copies a full, locked node into the next size up. */
+static struct ArtNode *grow(struct ArtNode *node) {
+  struct ArtNode *bigger = new_node(node->type + 1);
+  struct ArtNode4 *n4 = (struct ArtNode4*) node;
+  struct ArtNode16 *n16 = (struct ArtNode16*) node;
+  struct ArtNode48 *n48 = (struct ArtNode48*) node;
+  int i;
+  switch (node->type) {
+  case ART_NODE4:
+    memcpy(((struct ArtNode16*) bigger)->keys, n4->keys, node->count);
+    memcpy(((struct ArtNode16*) bigger)->children, n4->children,
+	   node->count * sizeof(struct ArtNode*));
+    break;
+  case ART_NODE16:
+    for (i = 0; i < node->count; i++) {
+      ((struct ArtNode48*) bigger)->index[n16->keys[i]] = i + 1;
+      ((struct ArtNode48*) bigger)->children[i] = n16->children[i];
+    }
+    break;
+  default:
+    for (i = 0; i < 256; i++)
+      if (n48->index[i] != 0)
+	((struct ArtNode256*) bigger)->children[i] =
+	  n48->children[n48->index[i] - 1];
+  }
+  bigger->count = node->count;
+  bigger->prefix_len = node->prefix_len;
+  bigger->prefix_key = node->prefix_key;
+  memcpy(bigger->prefix, node->prefix, ART_MAX_PREFIX);
+  return bigger;
+}
+
+
+/*! One attempt to add element n; 0 if it has to restart. */
+static int try_insert(struct ArtNode *root, const char *key, long n) {
+  struct ArtNode *node = root, *parent = NULL, *child, *split;
+  const char *other;
+  uint64_t v, pv = 0;
+  uint32_t depth = 0, len, m;
+  unsigned char byte, parent_byte = 0;
+
+  if (!read_lock(node, &v)) return 0;
+  while (1) {
+    len = node->prefix_len;
+    m = prefix_mismatch(node, len, key, depth);
+    if (m < len) {
+      /* key leaves the compressed path: a Node4 takes over the shared
+	 part and node keeps what follows the branching byte */
+      if (!upgrade(parent, pv)) return 0;
+      if (!upgrade(node, v)) {
+	write_unlock(parent);
+	return 0;
+      }
+      split = new_node(ART_NODE4);
+      set_prefix(split, node->prefix_key, depth, m);
+      add_child(split, node->prefix_key[depth + m], node);
+      add_child(split, key[depth + m], make_leaf(n));
+      set_prefix(node, node->prefix_key, depth + m + 1, len - m - 1);
+      *child_slot(parent, parent_byte) = split;
+      write_unlock(node);
+      write_unlock(parent);
+      return 1;
+    }
+    depth += len;
+    byte = key[depth];
+    child = find_child(node, byte);
+    if (!validate(node, v)) return 0;
+
+    if (child == NULL) {
+      if (is_full(node)) {
+	if (!upgrade(parent, pv)) return 0;
+	if (!upgrade(node, v)) {
+	  write_unlock(parent);
+	  return 0;
+	}
+	split = grow(node);
+	add_child(split, byte, make_leaf(n));
+	*child_slot(parent, parent_byte) = split;
+	write_unlock_obsolete(node);
+	write_unlock(parent);
+	return 1;
+      }
+      if (!upgrade(node, v)) return 0;
+      if (parent != NULL && !validate(parent, pv)) {
+	write_unlock(node);
+	return 0;
+      }
+      if (opt_yield & INSERT_YIELD)
+	sched_yield();
+      add_child(node, byte, make_leaf(n));
+      write_unlock(node);
+      return 1;
+    }
+
+    if (is_leaf(child)) {
+      /* two keys share this slot: push both down into a Node4 with
+	 their common bytes as its prefix */
+      if (!upgrade(node, v)) return 0;
+      other = list_elements[leaf_value(child)].key;
+      for (m = 0; key[depth + 1 + m] == other[depth + 1 + m]; m++) {
+	if (key[depth + 1 + m] == '\0') {
+	  fprintf(stderr, "Duplicate key cannot be stored in the radix "
+		  "tree.\r\n");
+	  exit(2);
+	}
+      }
+      if (opt_yield & INSERT_YIELD)
+	sched_yield();
+      split = new_node(ART_NODE4);
+      set_prefix(split, key, depth + 1, m);
+      add_child(split, other[depth + 1 + m], child);
+      add_child(split, key[depth + 1 + m], make_leaf(n));
+      *child_slot(node, byte) = split;
+      write_unlock(node);
+      return 1;
+    }
+
+    parent = node;
+    pv = v;
+    parent_byte = byte;
+    node = child;
+    if (!read_lock(node, &v) || !validate(parent, pv)) return 0;
+    depth++;
+  }
+}
+
+
+/*! Position of the element holding key, -1 if none, or ART_RESTART. */
+static long try_lookup(struct ArtNode *node, const char *key) {
+  struct ArtNode *child, *parent;
+  uint64_t v, pv;
+  uint32_t depth = 0, len;
+  long n;
+
+  if (!read_lock(node, &v)) return ART_RESTART;
+  while (1) {
+    len = node->prefix_len;
+    if (prefix_mismatch(node, len, key, depth) < len)
+      return validate(node, v) ? -1 : ART_RESTART;
+    depth += len;
+    child = find_child(node, key[depth]);
+    if (!validate(node, v)) return ART_RESTART;
+    if (child == NULL) return -1;
+    if (is_leaf(child)) {
+      if (opt_yield & LOOKUP_YIELD)
+	sched_yield();
+      n = leaf_value(child);
+      return (strcmp(list_elements[n].key, key) == 0) ? n : -1;
+    }
+    parent = node;
+    pv = v;
+    node = child;
+    if (!read_lock(node, &v) || !validate(parent, pv)) return ART_RESTART;
+    depth++;
+  }
+}
+
+
+/*! Clears element n's leaf: 0 if removed, 1 if it is not in the tree,
+    or ART_RESTART. */
+static int try_delete(struct ArtNode *node, const char *key, long n) {
+  struct ArtNode *child, *parent;
+  uint64_t v, pv;
+  uint32_t depth = 0, len;
+  unsigned char byte;
+
+  if (!read_lock(node, &v)) return ART_RESTART;
+  while (1) {
+    len = node->prefix_len;
+    if (prefix_mismatch(node, len, key, depth) < len)
+      return validate(node, v) ? 1 : ART_RESTART;
+    depth += len;
+    byte = key[depth];
+    child = find_child(node, byte);
+    if (!validate(node, v)) return ART_RESTART;
+    if (child == NULL) return 1;
+    if (is_leaf(child)) {
+      if (leaf_value(child) != n) return 1;
+      if (!upgrade(node, v)) return ART_RESTART;
+      if (opt_yield & DELETE_YIELD)
+	sched_yield();
+      remove_child(node, byte);
+      write_unlock(node);
+      return 0;
+    }
+    parent = node;
+    pv = v;
+    node = child;
+    if (!read_lock(node, &v) || !validate(parent, pv)) return ART_RESTART;
+    depth++;
+  }
+}
+
+
+/*! Copies node's children in key order into kids; returns how many. */
+static int list_children(struct ArtNode *node, struct ArtNode **kids) {
+  struct ArtNode4 *n4 = (struct ArtNode4*) node;
+  struct ArtNode16 *n16 = (struct ArtNode16*) node;
+  struct ArtNode48 *n48 = (struct ArtNode48*) node;
+  struct ArtNode256 *n256 = (struct ArtNode256*) node;
+  int i, num = 0, count = node->count;
+  switch (node->type) {
+  case ART_NODE4:
+    for (i = 0; i < count && i < 4; i++) kids[num++] = n4->children[i];
+    break;
+  case ART_NODE16:
+    for (i = 0; i < count && i < 16; i++) kids[num++] = n16->children[i];
+    break;
+  case ART_NODE48:
+    for (i = 0; i < 256; i++)
+      if (n48->index[i] > 0 && n48->index[i] <= 48)
+	kids[num++] = n48->children[n48->index[i] - 1];
+    break;
+  default:
+    for (i = 0; i < 256; i++)
+      if (n256->children[i] != NULL) kids[num++] = n256->children[i];
+  }
+  return num;
+}
+
+
+/*! Counts the leaves under node in key order, checking that their keys
+    ascend from *last. Returns -1 if they do not, ART_RESTART if a node
+    changed while it was read. */
+static long count_leaves(struct ArtNode *node, const char **last) {
+  struct ArtNode *kids[256];
+  const char *key;
+  uint64_t v;
+  long total = 0, sub;
+  int num, i;
+
+  if (!read_lock(node, &v)) return ART_RESTART;
+  num = list_children(node, kids);
+  if (!validate(node, v)) return ART_RESTART;
+
+  for (i = 0; i < num; i++) {
+    if (kids[i] == NULL) return ART_RESTART;
+    if (is_leaf(kids[i])) {
+      key = list_elements[leaf_value(kids[i])].key;
+      if (*last != NULL && strcmp(*last, key) > 0) return -1;
+      *last = key;
+      total++;
+      continue;
+    }
+    sub = count_leaves(kids[i], last);
+    if (sub < 0) return sub;
+    total += sub;
+  }
+  return total;
+}
+
+
+static void art_init(void) {
+  int bin;
+  roots = malloc(num_lists * sizeof(struct ArtNode*));
+  if (roots == NULL) {
+    fprintf(stderr, "Insufficient memory for radix tree roots.\r\n");
+    exit(2);
+  }
+  for (bin = 0; bin < num_lists; bin++)
+    roots[bin] = new_node(ART_NODE256);
+  retired_nodes = NULL;
+}
+
+
+static void art_insert(int bin, long n, long long *lock_time) {
+  *lock_time = 0;  /* readers and writers never block on each other */
+  while (try_insert(roots[bin], list_elements[n].key, n) == 0)
+    ;
+}
+
+
+static long art_lookup(int bin, const char *key, long long *lock_time) {
+  long result;
+  *lock_time = 0;
+  while ((result = try_lookup(roots[bin], key)) == ART_RESTART)
+    ;
+  return result;
+}
+
+
+static int art_delete(int bin, long n, long long *lock_time) {
+  int result;
+  *lock_time = 0;
+  while ((result = try_delete(roots[bin], list_elements[n].key, n))
+	 == ART_RESTART)
+    ;
+  return result;
+}
+
+
+static int art_length(int bin, long long *lock_time) {
+  const char *last;
+  long count;
+  *lock_time = 0;
+  if (opt_yield & LOOKUP_YIELD)
+    sched_yield();
+  do {
+    last = NULL;
+    count = count_leaves(roots[bin], &last);
+  } while (count == ART_RESTART);
+  return (int) count;
+}
+
+
+static void free_subtree(struct ArtNode *node) {
+  struct ArtNode *kids[256];
+  int num, i;
+  num = list_children(node, kids);
+  for (i = 0; i < num; i++)
+    if (!is_leaf(kids[i])) free_subtree(kids[i]);
+  free(node);
+}
+
+
+static void art_destroy(void) {
+  struct ArtNode *node, *next;
+  int bin;
+  for (bin = 0; bin < num_lists; bin++)
+    free_subtree(roots[bin]);
+  free(roots);
+  for (node = retired_nodes; node != NULL; node = next) {
+    next = node->retired;
+    free(node);
+  }
+}
+
+
+const struct ListBackend ArtTree_backend = {
+  "art",
+  art_init,
+  art_insert,
+  art_lookup,
+  art_delete,
+  art_length,
+  art_destroy,
+  NULL           /* no remove by key: lookup, then delete */
+};
@@ -0,0 +1,65 @@
+/*
+ * NAME: Jonathan Chang
+ * EMAIL: j.a.chang820@gmail.com
+ * ID: 104853981
+ */ 
+
+/** Adaptive radix tree (ART) with optimistic lock coupling.
+ *
+ *  Inner nodes branch on one key byte and come in four sizes
+ *  (Node4, Node16, Node48, Node256), growing into the next size when
+ *  full. A run of bytes shared by everything below a node is stored
+ *  once as its prefix (path compression): the first ART_MAX_PREFIX
+ *  bytes inline for a fast compare, the rest read from prefix_key,
+ *  any key that runs through the node. Leaves are not allocated: a
+ *  child pointer with bit 0 set holds the element's position in
+ *  list_elements, and the full key is checked there.
+ *
+ *  Synchronization follows the B+-tree: version counters, readers
+ *  that validate and restart, writers that upgrade with a CAS. A
+ *  node replaced by a bigger one is marked obsolete (bit 0) so
+ *  readers holding it restart, and is kept on a retired list until
+ *  the tree is destroyed. Deletes clear the leaf's slot without
+ *  shrinking nodes.
+ */
+
+#include <stdint.h>
+
+#define ART_MAX_PREFIX 8
+
+enum art_type {ART_NODE4, ART_NODE16, ART_NODE48, ART_NODE256};
+
+struct ArtNode {
+  uint64_t version;
+  uint8_t type;
+  uint16_t count;               /* children in use */
+  uint32_t prefix_len;
+  unsigned char prefix[ART_MAX_PREFIX];
+  const char *prefix_key;
+  struct ArtNode *retired;      /* next on the retired list */
+};
+
+struct ArtNode4 {
+  struct ArtNode n;
+  unsigned char keys[4];        /* sorted */
+  struct ArtNode *children[4];
+};
+
+struct ArtNode16 {
+  struct ArtNode n;
+  unsigned char keys[16];       /* sorted */
+  struct ArtNode *children[16];
+};
+
+struct ArtNode48 {
+  struct ArtNode n;
+  unsigned char index[256];     /* slot + 1, or 0 if no child */
+  struct ArtNode *children[48];
+};
+
+struct ArtNode256 {
+  struct ArtNode n;
+  struct ArtNode *children[256];
+};
+
+extern const struct ListBackend ArtTree_backend;
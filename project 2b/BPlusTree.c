@@ -0,0 +1,392 @@
+/*
+ * NAME: Jonathan Chang
+ * EMAIL: j.a.chang820@gmail.com
+ * ID: 104853981
+ */ 
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sched.h>
+#include "SortedList.h"
+#include "ListBackend.h"
+#include "BPlusTree.h"
+
+#define OLC_LOCKED 2
+
+static struct BTreeNode **roots;   /* one tree per sublist */
+
+
+static struct BTreeNode *new_node(int is_leaf) {
+  struct BTreeNode *node;
+  if (posix_memalign((void**) &node, 64, sizeof(struct BTreeNode)) != 0) {
+    fprintf(stderr, "Insufficient memory for B+-tree node.\r\n");
+    exit(2);
+  }
+  memset(node, 0, sizeof(struct BTreeNode));
+  node->is_leaf = is_leaf;
+  return node;
+}
+
+
+/*! Notes the version of an unlocked node; 0 if it is being written. */
+static int read_lock(struct BTreeNode *node, uint64_t *version) {
+  uint64_t v = __atomic_load_n(&node->version, __ATOMIC_ACQUIRE);
+  if (v & OLC_LOCKED) {
+    sched_yield();
+    return 0;
+  }
+  *version = v;
+  return 1;
+}
+
+
+/*! 1 if nothing was written to node since version was noted. */
+static int validate(struct BTreeNode *node, uint64_t version) {
+  __atomic_thread_fence(__ATOMIC_ACQUIRE);
+  return __atomic_load_n(&node->version, __ATOMIC_RELAXED) == version;
+}
+
+
+/*! Takes the write lock only if node is still at version. */
+static int upgrade(struct BTreeNode *node, uint64_t version) {
+  return __atomic_compare_exchange_n(&node->version, &version,
+				     version + OLC_LOCKED, 0,
+				     __ATOMIC_ACQUIRE, __ATOMIC_RELAXED);
+}
+
+
+static void write_unlock(struct BTreeNode *node) {
+  __atomic_fetch_add(&node->version, OLC_LOCKED, __ATOMIC_RELEASE);
+}
+
+
+static struct BTreeNode *load_root(int bin) {
+  return __atomic_load_n(&roots[bin], __ATOMIC_ACQUIRE);
+}
+
+
+/*! First position whose key is not less than key. A torn read can
+    show a bad count or an empty slot; both are cut short here and
+    caught by the caller's validate(). */
+static int lower_bound(struct BTreeNode *node, const char *key) {
+  int count = node->count;
+  int i;
+  if (count > BTREE_FANOUT) count = BTREE_FANOUT;
+  for (i = 0; i < count; i++) {
+    if (node->keys[i] == NULL || strcmp(node->keys[i], key) >= 0)
+      break;
+  }
+  return i;
+}
+
+
+/*! Splits a full node in half. Returns the new right sibling and
+    the separator: every key in node afterwards is <= *sep. */
+static struct BTreeNode *split(struct BTreeNode *node, const char **sep) {
+  struct BTreeNode *right = new_node(node->is_leaf);
+  int mid = node->count / 2;
+  if (node->is_leaf) {
+    right->count = node->count - mid;
+    memcpy(right->keys, node->keys + mid, right->count * sizeof(char*));
+    memcpy(right->values, node->values + mid, right->count * sizeof(long));
+    right->next = node->next;
+    node->count = mid;
+    *sep = node->keys[mid - 1];
+    __atomic_store_n(&node->next, right, __ATOMIC_RELEASE);
+  }
+  else {
+    right->count = node->count - mid - 1;
+    memcpy(right->keys, node->keys + mid + 1,
+	   right->count * sizeof(char*));
+    memcpy(right->children, node->children + mid + 1,
+	   (right->count + 1) * sizeof(struct BTreeNode*));
+    *sep = node->keys[mid];
+    node->count = mid;
+  }
+  return right;
+}
+
+
+/*! Adds separator sep between left and its new sibling right in a
+    locked parent that has room. */
+static void insert_separator(struct BTreeNode *parent, const char *sep,
+			     struct BTreeNode *left, struct BTreeNode *right) {
+  int pos = lower_bound(parent, sep);
+  memmove(parent->keys + pos + 1, parent->keys + pos,
+	  (parent->count - pos) * sizeof(char*));
+  memmove(parent->children + pos + 2, parent->children + pos + 1,
+	  (parent->count - pos) * sizeof(struct BTreeNode*));
+  parent->keys[pos] = sep;
+  parent->children[pos] = left;
+  parent->children[pos + 1] = right;
+  parent->count++;
+}
+
+
+/*! Splits a full node whose version is v under parent (at version pv,
+    or NULL for the root). Returns 0 if either had changed. */
+static int split_node(int bin, struct BTreeNode *node, uint64_t v,
+		      struct BTreeNode *parent, uint64_t pv) {
+  struct BTreeNode *right, *root;
+  const char *sep;
+  if (parent != NULL && !upgrade(parent, pv))
+    return 0;
+  if (!upgrade(node, v)) {
+    if (parent != NULL) write_unlock(parent);
+    return 0;
+  }
+  if (parent == NULL && node != load_root(bin)) {
+    write_unlock(node);
+    return 0;
+  }
+  right = split(node, &sep);
+  if (parent != NULL) {
+    insert_separator(parent, sep, node, right);
+  }
+  else {
+    root = new_node(0);
+    root->count = 1;
+    root->keys[0] = sep;
+    root->children[0] = node;
+    root->children[1] = right;
+    __atomic_store_n(&roots[bin], root, __ATOMIC_RELEASE);
+  }
+  write_unlock(node);
+  if (parent != NULL) write_unlock(parent);
+  return 1;
+}
+
+
+/*! Descends to the leaf that should hold key, splitting full nodes on
+    the way when for_insert is set. Returns the leaf and its version,
+    or NULL when the caller must restart. */
+static struct BTreeNode *find_leaf(int bin, const char *key, int for_insert,
+				   uint64_t *leaf_version,
+				   struct BTreeNode **parent_out,
+				   uint64_t *parent_version) {
+  struct BTreeNode *node, *child, *parent = NULL;
+  uint64_t v, pv = 0;
+
+  node = load_root(bin);
+  if (!read_lock(node, &v) || node != load_root(bin))
+    return NULL;
+
+  while (!node->is_leaf) {
+    if (for_insert && node->count == BTREE_FANOUT) {
+      split_node(bin, node, v, parent, pv);
+      return NULL;
+    }
+    if (parent != NULL && !validate(parent, pv))
+      return NULL;
+    parent = node;
+    pv = v;
+    child = node->children[lower_bound(node, key)];
+    if (!validate(node, v) || child == NULL)
+      return NULL;
+    node = child;
+    if (!read_lock(node, &v))
+      return NULL;
+  }
+  /* a split between the parent's last check and the leaf's read lock
+     may have moved key to a new right sibling the leaf cannot show */
+  if (parent != NULL && !validate(parent, pv))
+    return NULL;
+
+  if (for_insert && node->count == BTREE_FANOUT) {
+    split_node(bin, node, v, parent, pv);
+    return NULL;
+  }
+  *leaf_version = v;
+  *parent_out = parent;
+  *parent_version = pv;
+  return node;
+}
+
+
+static void btree_init(void) {
+  int bin;
+  roots = malloc(num_lists * sizeof(struct BTreeNode*));
+  if (roots == NULL) {
+    fprintf(stderr, "Insufficient memory for B+-tree roots.\r\n");
+    exit(2);
+  }
+  for (bin = 0; bin < num_lists; bin++)
+    roots[bin] = new_node(1);
+}
+
+
+static void btree_insert(int bin, long n, long long *lock_time) {
+  const char *key = list_elements[n].key;
+  struct BTreeNode *leaf, *parent;
+  uint64_t v, pv;
+  int pos;
+
+  *lock_time = 0;  /* readers and writers never block on each other */
+  while (1) {
+    leaf = find_leaf(bin, key, 1, &v, &parent, &pv);
+    if (leaf == NULL) continue;
+    if (!upgrade(leaf, v)) continue;
+    if (parent != NULL && !validate(parent, pv)) {
+      write_unlock(leaf);
+      continue;
+    }
+    break;
+  }
+
+  if (opt_yield & INSERT_YIELD)
+    sched_yield();
+
+  pos = lower_bound(leaf, key);
+  memmove(leaf->keys + pos + 1, leaf->keys + pos,
+	  (leaf->count - pos) * sizeof(char*));
+  memmove(leaf->values + pos + 1, leaf->values + pos,
+	  (leaf->count - pos) * sizeof(long));
+  leaf->keys[pos] = key;
+  leaf->values[pos] = n;
+  leaf->count++;
+  write_unlock(leaf);
+}
+
+
+static long btree_lookup(int bin, const char *key, long long *lock_time) {
+  struct BTreeNode *leaf, *parent;
+  uint64_t v, pv;
+  long result;
+  int pos;
+
+  *lock_time = 0;
+  while (1) {
+    leaf = find_leaf(bin, key, 0, &v, &parent, &pv);
+    if (leaf == NULL) continue;
+
+    if (opt_yield & LOOKUP_YIELD)
+      sched_yield();
+
+    pos = lower_bound(leaf, key);
+    result = -1;
+    if (pos < leaf->count && pos < BTREE_FANOUT &&
+	leaf->keys[pos] != NULL && strcmp(leaf->keys[pos], key) == 0)
+      result = leaf->values[pos];
+    if (validate(leaf, v)) return result;
+  }
+}
+
+
+/*! Removes element n from its leaf; 1 if it is not in the tree. */
+static int btree_delete(int bin, long n, long long *lock_time) {
+  const char *key = list_elements[n].key;
+  struct BTreeNode *leaf, *parent;
+  uint64_t v, pv;
+  int pos;
+
+  *lock_time = 0;
+  while (1) {
+    leaf = find_leaf(bin, key, 0, &v, &parent, &pv);
+    if (leaf == NULL) continue;
+    if (upgrade(leaf, v)) break;
+  }
+
+  if (opt_yield & DELETE_YIELD)
+    sched_yield();
+
+  /* equal keys sit together; pick the entry for this element */
+  for (pos = lower_bound(leaf, key); pos < leaf->count; pos++) {
+    if (strcmp(leaf->keys[pos], key) != 0) {
+      pos = leaf->count;
+      break;
+    }
+    if (leaf->values[pos] == n) break;
+  }
+  if (pos == leaf->count) {
+    write_unlock(leaf);
+    return 1;
+  }
+  memmove(leaf->keys + pos, leaf->keys + pos + 1,
+	  (leaf->count - pos - 1) * sizeof(char*));
+  memmove(leaf->values + pos, leaf->values + pos + 1,
+	  (leaf->count - pos - 1) * sizeof(long));
+  leaf->count--;
+  write_unlock(leaf);
+  return 0;
+}
+
+
+/*! Counts the entries leaf by leaf along the leaf chain, re-reading
+    any leaf that changed while it was counted. -1 if keys are out of
+    order. */
+static int btree_length(int bin, long long *lock_time) {
+  struct BTreeNode *node, *next;
+  const char *last = NULL, *first_key, *last_key;
+  uint64_t v;
+  int count = 0, leaf_count, sorted, i, ok;
+
+  *lock_time = 0;
+  if (opt_yield & LOOKUP_YIELD)
+    sched_yield();
+
+  /* leftmost leaf */
+  do {
+    node = load_root(bin);
+    ok = read_lock(node, &v);
+    while (ok && !node->is_leaf) {
+      next = node->children[0];
+      ok = validate(node, v) && next != NULL;
+      if (ok) {
+	node = next;
+	ok = read_lock(node, &v);
+      }
+    }
+  } while (!ok);
+
+  while (node != NULL) {
+    if (!read_lock(node, &v)) continue;
+    leaf_count = node->count;
+    if (leaf_count > BTREE_FANOUT) continue;
+    sorted = 1;
+    for (i = 1; i < leaf_count; i++)
+      if (node->keys[i - 1] == NULL || node->keys[i] == NULL ||
+	  strcmp(node->keys[i - 1], node->keys[i]) > 0)
+	sorted = 0;
+    first_key = (leaf_count > 0) ? node->keys[0] : NULL;
+    last_key = (leaf_count > 0) ? node->keys[leaf_count - 1] : NULL;
+    next = __atomic_load_n(&node->next, __ATOMIC_ACQUIRE);
+    if (!validate(node, v)) continue;
+    if (!sorted ||
+	(last != NULL && first_key != NULL && strcmp(last, first_key) > 0))
+      return -1;
+    if (last_key != NULL) last = last_key;
+    count += leaf_count;
+    node = next;
+  }
+  return count;
+}
+
+
+static void free_tree(struct BTreeNode *node) {
+  int i;
+  if (!node->is_leaf)
+    for (i = 0; i <= node->count; i++)
+      free_tree(node->children[i]);
+  free(node);
+}
+
+
+static void btree_destroy(void) {
+  int bin;
+  for (bin = 0; bin < num_lists; bin++)
+    free_tree(roots[bin]);
+  free(roots);
+}
+
+
+const struct ListBackend BPlusTree_backend = {
+  "bplus",
+  btree_init,
+  btree_insert,
+  btree_lookup,
+  btree_delete,
+  btree_length,
+  btree_destroy,
+  NULL           /* no remove by key: lookup, then delete */
+};
@@ -0,0 +1,37 @@
+/*
+ * NAME: Jonathan Chang
+ * EMAIL: j.a.chang820@gmail.com
+ * ID: 104853981
+ */ 
+
+/** B+-tree with optimistic lock coupling, one tree per sublist.
+ *
+ *  Every node carries a version word whose bit 1 is the write lock.
+ *  Readers never write to shared memory: they note a node's version,
+ *  read it, and check that the version has not moved before trusting
+ *  what they read (or the child they are about to visit), restarting
+ *  from the root otherwise. Writers upgrade the version they read to
+ *  a locked one with a compare-and-swap, and unlocking bumps it.
+ *
+ *  Full nodes are split on the way down, so a split only ever needs
+ *  the node and its parent locked. Deletes remove the entry from its
+ *  leaf without merging, so nodes are never freed during a run and
+ *  readers can follow any pointer they have validated. Leaves are
+ *  chained left to right for length().
+ */
+
+#include <stdint.h>
+
+#define BTREE_FANOUT 16   /* most keys in a node */
+
+struct BTreeNode {
+  uint64_t version;
+  int is_leaf;
+  int count;                                     /* keys in use */
+  const char *keys[BTREE_FANOUT];
+  struct BTreeNode *children[BTREE_FANOUT + 1];  /* inner nodes */
+  long values[BTREE_FANOUT];                     /* leaves */
+  struct BTreeNode *next;                        /* leaves */
+} __attribute__((aligned(64)));
+
+extern const struct ListBackend BPlusTree_backend;
@@ -0,0 +1,127 @@
+/*
+ * NAME: Jonathan Chang
+ * EMAIL: j.a.chang820@gmail.com
+ * ID: 104853981
+ */ 
+
+#include <time.h>
+#include <errno.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include "PreciseTimer.h"
+#include "ChromeTrace.h"
+
+int trace_enabled = 0;
+long long trace_threshold = 1000;
+
+static struct TraceBuffer *buffers;
+static int num_buffers;
+static struct PreciseTimer origin;
+static __thread struct TraceBuffer *own_buffer;
+
+
+static long long since_origin(struct PreciseTimer *timer) {
+  return PreciseTimer_start_ns(timer) - PreciseTimer_start_ns(&origin);
+}
+
+
+void ChromeTrace_init(int threads, int capacity) {
+  int t;
+  num_buffers = threads;
+  buffers = calloc(threads, sizeof(struct TraceBuffer));
+  if (buffers == NULL) {
+    fprintf(stderr, "Insufficient memory for trace buffers.\r\n");
+    exit(2);
+  }
+  for (t = 0; t < threads; t++) {
+    buffers[t].events = malloc(capacity * sizeof(struct TraceEvent));
+    if (buffers[t].events == NULL) {
+      fprintf(stderr, "Insufficient memory for trace buffers.\r\n");
+      exit(2);
+    }
+    buffers[t].capacity = capacity;
+  }
+  PreciseTimer_start(&origin);
+  trace_enabled = 1;
+}
+
+
+/*! Binds the calling thread to its buffer. */
+void ChromeTrace_attach(int tid) {
+  own_buffer = &buffers[tid];
+}
+
+
+/*! Records the interval last measured by timer on the calling thread. */
+void ChromeTrace_span(const char *name, struct PreciseTimer *timer, int arg) {
+  struct TraceBuffer *buf = own_buffer;
+  struct TraceEvent *event;
+  if (buf == NULL) return;
+  if (buf->count == buf->capacity) {
+    buf->dropped++;
+    return;
+  }
+  event = &buf->events[buf->count++];
+  event->name = name;
+  event->start = since_origin(timer);
+  event->dur = timer->diff;
+  event->arg = arg;
+}
+
+
+void ChromeTrace_write(const char *file_name) {
+  FILE *file;
+  struct TraceEvent *event;
+  int t, n;
+  long dropped = 0;
+  const char *sep = "";
+
+  file = fopen(file_name, "w");
+  if (file == NULL) {
+    fprintf(stderr, "Trace file %s could not be opened.\r\n%s\r\n",
+	    file_name, strerror(errno));
+    exit(2);
+  }
+
+  fprintf(file, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n");
+  for (t = 0; t < num_buffers; t++) {
+    fprintf(file, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,"
+	    "\"tid\":%d,\"args\":{\"name\":\"worker %d\"}}", sep, t, t);
+    sep = ",\n";
+    for (n = 0; n < buffers[t].count; n++) {
+      event = &buffers[t].events[n];
+      /* timestamps are in microseconds */
+      fprintf(file, ",\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,"
+	      "\"ts\":%lld.%03lld,\"dur\":%lld.%03lld",
+	      event->name, t,
+	      event->start / 1000, event->start % 1000,
+	      event->dur / 1000, event->dur % 1000);
+      if (event->arg >= 0)
+	fprintf(file, ",\"args\":{\"bin\":%d}", event->arg);
+      fprintf(file, "}");
+    }
+    dropped += buffers[t].dropped;
+  }
+  fprintf(file, "\n]}\n");
+
+  if (fclose(file) != 0) {
+    fprintf(stderr, "Trace file %s could not be written.\r\n%s\r\n",
+	    file_name, strerror(errno));
+    exit(2);
+  }
+  if (dropped > 0)
+    fprintf(stderr, "Trace buffers were full; %ld events dropped.\r\n",
+	    dropped);
+}
+
+
+void ChromeTrace_destroy(void) {
+  int t;
+  if (buffers == NULL) return;
+  for (t = 0; t < num_buffers; t++)
+    free(buffers[t].events);
+  free(buffers);
+  buffers = NULL;
+  trace_enabled = 0;
+}
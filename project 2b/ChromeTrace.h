@@ -0,0 +1,38 @@
+/*
+ * NAME: Jonathan Chang
+ * EMAIL: j.a.chang820@gmail.com
+ * ID: 104853981
+ */ 
+
+/** Timeline of worker phases in Chrome trace-event format.
+ *
+ *  Every worker owns one TraceBuffer, preallocated before the threads
+ *  start, and appends complete ("X") events to it without locking.
+ *  The buffers are written out as JSON once all threads have joined,
+ *  and the file can be opened in chrome://tracing or Perfetto.
+ */
+
+struct PreciseTimer;
+
+struct TraceEvent {
+  const char *name;
+  long long start;  /* ns since ChromeTrace_init */
+  long long dur;    /* ns */
+  int arg;          /* sublist for lock waits, -1 otherwise */
+};
+
+struct TraceBuffer {
+  struct TraceEvent *events;
+  int count;
+  int capacity;
+  long dropped;
+} __attribute__((aligned(64)));
+
+extern int trace_enabled;
+extern long long trace_threshold;
+
+void ChromeTrace_init(int threads, int capacity);
+void ChromeTrace_attach(int tid);
+void ChromeTrace_span(const char *name, struct PreciseTimer *timer, int arg);
+void ChromeTrace_write(const char *file_name);
+void ChromeTrace_destroy(void);
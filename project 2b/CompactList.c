@@ -0,0 +1,184 @@
+/*
+ * NAME: Jonathan Chang
+ * EMAIL: j.a.chang820@gmail.com
+ * ID: 104853981
+ */ 
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sched.h>
+#include "SortedList.h"
+#include "ListBackend.h"
+#include "CompactList.h"
+
+static struct CompactNode *nodes;
+static char *key_pool;
+static uint32_t head_base;   /* index of sublist 0's head */
+
+
+static inline const char *key_of(uint32_t index) {
+  return key_pool + nodes[index].key;
+}
+
+
+/*! Copies every key into the pool and links each sublist head to
+    itself as an empty list. */
+static void compact_init(void) {
+  long n;
+  size_t offset = 0, pool_size = 0;
+  if (num_elements + num_lists >= COMPACT_NIL) {
+    fprintf(stderr, "Too many elements for 32-bit indices.\r\n");
+    exit(1);
+  }
+  for (n = 0; n < num_elements; n++)
+    pool_size += strlen(list_elements[n].key) + 1;
+  if (pool_size > COMPACT_NIL) {
+    fprintf(stderr, "Keys do not fit in a 32-bit key pool.\r\n");
+    exit(1);
+  }
+  nodes = malloc((num_elements + num_lists) * sizeof(struct CompactNode));
+  key_pool = malloc(pool_size);
+  if (nodes == NULL || key_pool == NULL) {
+    fprintf(stderr, "Insufficient memory for compact list.\r\n");
+    exit(2);
+  }
+  for (n = 0; n < num_elements; n++) {
+    size_t len = strlen(list_elements[n].key) + 1;
+    memcpy(key_pool + offset, list_elements[n].key, len);
+    nodes[n].key = (uint32_t) offset;
+    nodes[n].prev = COMPACT_NIL;
+    nodes[n].next = COMPACT_NIL;
+    offset += len;
+  }
+  head_base = (uint32_t) num_elements;
+  for (n = head_base; n < head_base + num_lists; n++) {
+    nodes[n].key = COMPACT_NIL;
+    nodes[n].prev = COMPACT_NIL;
+    nodes[n].next = COMPACT_NIL;
+  }
+}
+
+
+static void compact_insert(int bin, long n, long long *lock_time) {
+  uint32_t it = head_base + bin;
+  uint32_t el = (uint32_t) n;
+  const char *key = key_of(el);
+  long limiter = 0;
+
+  set_lock(bin, lock_time);
+
+  while (nodes[it].next != COMPACT_NIL &&
+	 strcmp(key_of(nodes[it].next), key) < 0) {
+    if (limiter >= num_elements) break; /* prevent infinite loops */
+    it = nodes[it].next;
+    limiter++;
+  }
+
+  if (opt_yield & INSERT_YIELD)
+    sched_yield();
+
+  nodes[el].next = nodes[it].next;
+  if (nodes[it].next != COMPACT_NIL)
+    nodes[nodes[it].next].prev = el;
+  nodes[el].prev = it;
+  nodes[it].next = el;
+
+  release_lock(bin);
+}
+
+
+static long compact_lookup(int bin, const char *key, long long *lock_time) {
+  uint32_t it = head_base + bin;
+  long limiter = 0;
+  long result = -1;
+
+  set_lock(bin, lock_time);
+
+  while (nodes[it].next != COMPACT_NIL &&
+	 strcmp(key_of(nodes[it].next), key) != 0) {
+    if (limiter >= num_elements) break; /* prevent infinite loops */
+    it = nodes[it].next;
+    limiter++;
+  }
+
+  if (opt_yield & LOOKUP_YIELD)
+    sched_yield();
+
+  if (nodes[it].next != COMPACT_NIL && limiter < num_elements)
+    result = nodes[it].next;
+
+  release_lock(bin);
+  return result;
+}
+
+
+static int compact_delete(int bin, long n, long long *lock_time) {
+  uint32_t el = (uint32_t) n;
+  uint32_t prev, next;
+
+  set_lock(bin, lock_time);
+
+  prev = nodes[el].prev;
+  next = nodes[el].next;
+  if (prev == COMPACT_NIL ||                       /* not in a list */
+      nodes[prev].next != el ||                    /* corrupted */
+      (next != COMPACT_NIL && nodes[next].prev != el)) {
+    release_lock(bin);
+    return 1;
+  }
+
+  if (opt_yield & DELETE_YIELD)
+    sched_yield();
+
+  nodes[prev].next = next;
+  if (next != COMPACT_NIL)
+    nodes[next].prev = prev;
+
+  release_lock(bin);
+
+  nodes[el].prev = COMPACT_NIL;
+  nodes[el].next = COMPACT_NIL;
+  return 0;
+}
+
+
+static int compact_length(int bin, long long *lock_time) {
+  uint32_t it = head_base + bin;
+  int count = 0;
+
+  if (opt_yield & LOOKUP_YIELD)
+    sched_yield();
+
+  set_lock(bin, lock_time);
+
+  while (nodes[it].next != COMPACT_NIL) {
+    if (nodes[nodes[it].next].prev != it || count >= num_elements) {
+      count = -1; /* list corrupted */
+      break;
+    }
+    count++;
+    it = nodes[it].next;
+  }
+
+  release_lock(bin);
+  return count;
+}
+
+
+static void compact_destroy(void) {
+  free(nodes);
+  free(key_pool);
+}
+
+
+const struct ListBackend CompactList_backend = {
+  "compact",
+  compact_init,
+  compact_insert,
+  compact_lookup,
+  compact_delete,
+  compact_length,
+  compact_destroy,
+  NULL           /* no remove by key: lookup, then delete */
+};
@@ -0,0 +1,26 @@
+/*
+ * NAME: Jonathan Chang
+ * EMAIL: j.a.chang820@gmail.com
+ * ID: 104853981
+ */ 
+
+/** Sorted list linked by 32-bit indices into list_elements.
+ *
+ *  A CompactNode is 12 bytes instead of the 24 of a
+ *  SortedListElement, and the keys are copied into one contiguous
+ *  pool that nodes refer to by offset, so a traversal touches half
+ *  the node memory and no scattered strdup() blocks. Node n
+ *  mirrors list_elements[n]; the sublist heads follow the elements.
+ */
+
+#include <stdint.h>
+
+#define COMPACT_NIL UINT32_MAX
+
+struct CompactNode {
+  uint32_t prev;
+  uint32_t next;
+  uint32_t key;   /* offset into the key pool */
+};
+
+extern const struct ListBackend CompactList_backend;
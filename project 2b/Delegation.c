@@ -0,0 +1,215 @@
+/*
+ * NAME: Jonathan Chang
+ * EMAIL: j.a.chang820@gmail.com
+ * ID: 104853981
+ */ 
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <sched.h>
+#include <pthread.h>
+#include "SortedList.h"
+#include "ListBackend.h"
+#include "PreciseTimer.h"
+#include "Delegation.h"
+
+static const struct ListBackend *inner;
+static struct ListBackend delegation;
+static struct DelegateQueue *queues;
+static pthread_t *servers;
+static int *server_bin;
+static int stop_servers;
+
+
+static void push(struct DelegateQueue *queue, struct DelegateRequest *req) {
+  struct DelegateRequest *prev;
+  req->next = NULL;
+  prev = __atomic_exchange_n(&queue->in, req, __ATOMIC_ACQ_REL);
+  __atomic_store_n(&prev->next, req, __ATOMIC_RELEASE);
+}
+
+
+/*! Next request, or NULL if none is ready. Only the owner calls this. */
+static struct DelegateRequest *pop(struct DelegateQueue *queue) {
+  struct DelegateRequest *out = queue->out;
+  struct DelegateRequest *next = __atomic_load_n(&out->next,
+						 __ATOMIC_ACQUIRE);
+  if (out == &queue->stub) {
+    if (next == NULL) return NULL;
+    queue->out = next;
+    out = next;
+    next = __atomic_load_n(&out->next, __ATOMIC_ACQUIRE);
+  }
+  if (next != NULL) {
+    queue->out = next;
+    return out;
+  }
+  /* out is the last request: a producer may be between its exchange
+     and its link, in which case try again later */
+  if (out != __atomic_load_n(&queue->in, __ATOMIC_ACQUIRE))
+    return NULL;
+  push(queue, &queue->stub);
+  next = __atomic_load_n(&out->next, __ATOMIC_ACQUIRE);
+  if (next != NULL) {
+    queue->out = next;
+    return out;
+  }
+  return NULL;
+}
+
+
+/*! Owner of one sublist: serves its queue until told to stop. */
+static void* serve(void* bin_ptr) {
+  int bin = *((int*) bin_ptr);
+  struct DelegateQueue *queue = &queues[bin];
+  struct DelegateRequest *req;
+  long long unused;
+  long result = 0;
+
+  while (!__atomic_load_n(&stop_servers, __ATOMIC_ACQUIRE)) {
+    req = pop(queue);
+    if (req == NULL) {
+      sched_yield();
+      continue;
+    }
+    switch (req->op) {
+    case DELEGATE_INSERT:
+      inner->insert(bin, req->n, &unused);
+      result = 0;
+      break;
+    case DELEGATE_LOOKUP:
+      result = inner->lookup(bin, req->key, &unused);
+      break;
+    case DELEGATE_DELETE:
+      result = inner->delete(bin, req->n, &unused);
+      break;
+    case DELEGATE_LENGTH:
+      result = inner->length(bin, &unused);
+      break;
+    case DELEGATE_REMOVE:
+      result = inner->remove(bin, req->key, &unused);
+      break;
+    }
+    req->result = result;
+    __atomic_store_n(&req->done, 1, __ATOMIC_RELEASE);  /* req is gone */
+  }
+  return NULL;
+}
+
+
+/*! Hands a request to the owner of bin and waits for the answer. The
+    wait (queueing plus service) is reported as the lock time. */
+static long delegate(int bin, struct DelegateRequest *req,
+		     long long *lock_time) {
+  struct PreciseTimer timer;
+  req->done = 0;
+  PreciseTimer_start(&timer);
+  push(&queues[bin], req);
+  while (!__atomic_load_n(&req->done, __ATOMIC_ACQUIRE))
+    sched_yield();
+  PreciseTimer_end(&timer);
+  *lock_time = timer.diff;
+  return req->result;
+}
+
+
+static void delegation_init(void) {
+  int bin;
+  if (inner->init != NULL) inner->init();
+  if (posix_memalign((void**) &queues, CACHE_LINE_SIZE,
+		     num_lists * sizeof(struct DelegateQueue)) != 0) {
+    fprintf(stderr, "Insufficient memory for delegation queues.\r\n");
+    exit(2);
+  }
+  servers = calloc(num_lists, sizeof(pthread_t));
+  server_bin = calloc(num_lists, sizeof(int));
+  if (servers == NULL || server_bin == NULL) {
+    fprintf(stderr, "Insufficient memory for delegation servers.\r\n");
+    exit(2);
+  }
+  stop_servers = 0;
+  for (bin = 0; bin < num_lists; bin++) {
+    memset(&queues[bin], 0, sizeof(struct DelegateQueue));
+    queues[bin].in = &queues[bin].stub;
+    queues[bin].out = &queues[bin].stub;
+    server_bin[bin] = bin;
+    if (pthread_create(&servers[bin], NULL, serve, &server_bin[bin]) != 0) {
+      fprintf(stderr, "Cannot create owner thread for sublist %d.\r\n%s\r\n",
+	      bin, strerror(errno));
+      exit(2);
+    }
+  }
+}
+
+
+static void delegation_insert(int bin, long n, long long *lock_time) {
+  struct DelegateRequest req;
+  req.op = DELEGATE_INSERT;
+  req.n = n;
+  delegate(bin, &req, lock_time);
+}
+
+
+static long delegation_lookup(int bin, const char *key,
+			      long long *lock_time) {
+  struct DelegateRequest req;
+  req.op = DELEGATE_LOOKUP;
+  req.key = key;
+  return delegate(bin, &req, lock_time);
+}
+
+
+static int delegation_delete(int bin, long n, long long *lock_time) {
+  struct DelegateRequest req;
+  req.op = DELEGATE_DELETE;
+  req.n = n;
+  return (int) delegate(bin, &req, lock_time);
+}
+
+
+static int delegation_length(int bin, long long *lock_time) {
+  struct DelegateRequest req;
+  req.op = DELEGATE_LENGTH;
+  return (int) delegate(bin, &req, lock_time);
+}
+
+
+static int delegation_remove(int bin, const char *key,
+			     long long *lock_time) {
+  struct DelegateRequest req;
+  req.op = DELEGATE_REMOVE;
+  req.key = key;
+  return (int) delegate(bin, &req, lock_time);
+}
+
+
+static void delegation_destroy(void) {
+  int bin;
+  __atomic_store_n(&stop_servers, 1, __ATOMIC_RELEASE);
+  for (bin = 0; bin < num_lists; bin++)
+    pthread_join(servers[bin], NULL);
+  free(servers);
+  free(server_bin);
+  free(queues);
+  if (inner->destroy != NULL) inner->destroy();
+}
+
+
+/*! Returns a backend that forwards every operation on a sublist to
+    that sublist's owner, which runs it on wrapped. wrapped should use
+    no locks of its own. */
+const struct ListBackend *Delegation_wrap(const struct ListBackend *wrapped) {
+  inner = wrapped;
+  delegation.name = wrapped->name;
+  delegation.init = delegation_init;
+  delegation.insert = delegation_insert;
+  delegation.lookup = delegation_lookup;
+  delegation.delete = delegation_delete;
+  delegation.length = delegation_length;
+  delegation.destroy = delegation_destroy;
+  delegation.remove = (wrapped->remove != NULL) ? delegation_remove : NULL;
+  return &delegation;
+}
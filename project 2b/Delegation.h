@@ -0,0 +1,43 @@
+/*
+ * NAME: Jonathan Chang
+ * EMAIL: j.a.chang820@gmail.com
+ * ID: 104853981
+ */ 
+
+/** Delegation: each sublist is owned by one server thread.
+ *
+ *  Workers never touch a sublist themselves. They describe the
+ *  operation in a DelegateRequest on their own stack, push it onto
+ *  the owner's queue and wait for done to be set. The owner runs
+ *  requests one at a time against the wrapped backend without locks,
+ *  so a sublist's nodes stay in the owner's cache and no lock word
+ *  moves between cores.
+ *
+ *  The queue is an intrusive multi-producer/single-consumer list:
+ *  producers swap themselves into in with one atomic exchange and
+ *  then link the previous request to themselves; only the owner
+ *  reads from out. A stub node keeps the queue from ever being
+ *  empty of nodes.
+ */
+
+#define CACHE_LINE_SIZE 64
+
+enum delegate_op {DELEGATE_INSERT, DELEGATE_LOOKUP, DELEGATE_DELETE,
+		  DELEGATE_LENGTH, DELEGATE_REMOVE};
+
+struct DelegateRequest {
+  struct DelegateRequest *next;
+  enum delegate_op op;
+  long n;
+  const char *key;
+  long result;
+  int done;
+};
+
+struct DelegateQueue {
+  struct DelegateRequest *in __attribute__((aligned(CACHE_LINE_SIZE)));
+  struct DelegateRequest *out __attribute__((aligned(CACHE_LINE_SIZE)));
+  struct DelegateRequest stub;
+};
+
+const struct ListBackend *Delegation_wrap(const struct ListBackend *inner);
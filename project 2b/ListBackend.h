@@ -0,0 +1,38 @@
+/*
+ * NAME: Jonathan Chang
+ * EMAIL: j.a.chang820@gmail.com
+ * ID: 104853981
+ */ 
+
+/** Storage behind the lab2_list driver.
+ *
+ *  Every element already lives in list_elements, so a backend only
+ *  has to index them: insert and delete take the element's position
+ *  n in that array, and lookup returns the position of the element
+ *  holding key, or -1. bin is the sublist chosen by get_bin(). Each
+ *  call stores the time spent waiting for locks in *lock_time.
+ *  init runs after the elements and sync objects exist; init and
+ *  destroy may be NULL. remove, when not NULL, deletes the element
+ *  holding key in one call; otherwise the driver looks it up and then
+ *  deletes it.
+ */
+
+struct ListBackend {
+  const char *name;
+  void (*init)(void);
+  void (*insert)(int bin, long n, long long *lock_time);
+  long (*lookup)(int bin, const char *key, long long *lock_time);
+  int (*delete)(int bin, long n, long long *lock_time);  /* 1: corrupted */
+  int (*length)(int bin, long long *lock_time);          /* -1: corrupted */
+  void (*destroy)(void);
+  int (*remove)(int bin, const char *key, long long *lock_time);
+					/* 1: corrupted, -1: not found */
+};
+
+extern SortedListElement_t *list_elements;
+extern long num_elements;
+extern int num_lists;
+
+/* sublist locks shared by all backends, from SortedList.c */
+void set_lock(int bin, long long *lock_time);
+void release_lock(int bin);
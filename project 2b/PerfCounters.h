@@ -0,0 +1,36 @@
+/*
+ * NAME: Jonathan Chang
+ * EMAIL: j.a.chang820@gmail.com
+ * ID: 104853981
+ */ 
+
+/** Per-thread perf_event_open counters.
+ *
+ *  PerfCounters_start opens and enables the counters for the calling
+ *  thread only, so every worker thread keeps its own set and the
+ *  totals are summed after the work is done.
+ *
+ *  Hardware events are tried first. When the PMU is unavailable
+ *  (virtual machines, perf_event_paranoid), software events are used
+ *  instead: task-clock (ns) stands in for cycles, page faults stand in
+ *  for LLC misses and instructions are not counted (-1).
+ */
+
+#define PERF_NUM_EVENTS 4
+
+enum perf_event_index {PERF_CYCLES, PERF_INSTRUCTIONS, PERF_LLC_MISSES,
+		       PERF_CONTEXT_SWITCHES};
+
+enum perf_source {PERF_NONE, PERF_SOFTWARE, PERF_HARDWARE};
+
+struct PerfCounters {
+  int fd[PERF_NUM_EVENTS];
+  long long count[PERF_NUM_EVENTS];
+  enum perf_source source;
+};
+
+void PerfCounters_start(struct PerfCounters *counters);
+void PerfCounters_stop(struct PerfCounters *counters);
+void PerfCounters_clear(struct PerfCounters *total);
+void PerfCounters_add(struct PerfCounters *total, struct PerfCounters *counters);
+int PerfCounters_format(char *buf, struct PerfCounters *total, long operations);
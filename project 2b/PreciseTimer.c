@@ -10,6 +10,19 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include "PreciseTimer.h"
+#if defined(__x86_64__) || defined(__i386__)
+#include <cpuid.h>
+#include <x86intrin.h>
+#define HAVE_TSC 1
+#endif
+
+/* how long to watch both clocks when calibrating the TSC */
+#define CALIBRATION_NS 20000000
+
+enum timer_source timer_source = TIMER_CLOCK;
+static double ns_per_tick;
+static unsigned long long tsc_base;
+static long long ns_base;
 
 
 static void get_monotonic_time(struct timespec *tp) {
@@ -45,8 +58,69 @@ static long long get_diff(struct timespec *start, struct timespec *end) {
 }
 
 
+#ifdef HAVE_TSC
+/*! The lfence keeps rdtsc from starting before earlier loads finish. */
+static inline unsigned long long read_tsc_start(void) {
+  _mm_lfence();
+  return __rdtsc();
+}
+
+
+/*! rdtscp waits for the timed code to finish; the lfence keeps later
+    code from starting before the counter is read. */
+static inline unsigned long long read_tsc_end(void) {
+  unsigned int aux;
+  unsigned long long tsc = __rdtscp(&aux);
+  _mm_lfence();
+  return tsc;
+}
+#endif
+
+
+/*! Switches every timer to the time-stamp counter. The TSC must be
+    invariant (constant rate across frequency and sleep states) and
+    rdtscp must exist, otherwise the clock stays in use and 0 is
+    returned. The tick rate is measured once against CLOCK_MONOTONIC. */
+int PreciseTimer_use_tsc(void) {
+#ifdef HAVE_TSC
+  unsigned int eax, ebx, ecx, edx;
+  struct timespec t0, t1;
+  unsigned long long c0, c1;
+
+  if (__get_cpuid(0x80000007, &eax, &ebx, &ecx, &edx) == 0 ||
+      !(edx & (1 << 8)))
+    return 0;
+  if (__get_cpuid(0x80000001, &eax, &ebx, &ecx, &edx) == 0 ||
+      !(edx & (1 << 27)))
+    return 0;
+
+  get_monotonic_time(&t0);
+  c0 = read_tsc_start();
+  do {
+    get_monotonic_time(&t1);
+  } while (get_diff(&t0, &t1) < CALIBRATION_NS);
+  c1 = read_tsc_end();
+  if (c1 <= c0) return 0;
+
+  ns_per_tick = (double) get_diff(&t0, &t1) / (double) (c1 - c0);
+  tsc_base = c0;
+  ns_base = (long long) t0.tv_sec * (long long) 1E9 + t0.tv_nsec;
+  timer_source = TIMER_TSC;
+  return 1;
+#else
+  return 0;
+#endif
+}
+
+
 void PreciseTimer_start(struct PreciseTimer *timer) {
   struct timespec *start = &(timer->start_time);
+#ifdef HAVE_TSC
+  if (timer_source == TIMER_TSC) {
+    timer->start_tsc = read_tsc_start();
+    return;
+  }
+#endif
   get_monotonic_time(start);
 }
 
@@ -54,11 +128,29 @@ void PreciseTimer_start(struct PreciseTimer *timer) {
 void PreciseTimer_end(struct PreciseTimer *timer) {
   struct timespec *start = &(timer->start_time);
   struct timespec *end = &(timer->end_time);
+#ifdef HAVE_TSC
+  if (timer_source == TIMER_TSC) {
+    timer->end_tsc = read_tsc_end();
+    timer->diff = (long long) ((timer->end_tsc - timer->start_tsc) *
+			       ns_per_tick);
+    return;
+  }
+#endif
   get_monotonic_time(end);
   timer->diff = get_diff(start, end);
 }
 
 
+/*! Start of the last measurement, in ns on the CLOCK_MONOTONIC scale. */
+long long PreciseTimer_start_ns(struct PreciseTimer *timer) {
+  struct timespec *start = &(timer->start_time);
+  if (timer_source == TIMER_TSC)
+    return ns_base + (long long) ((double) (timer->start_tsc - tsc_base) *
+				  ns_per_tick);
+  return (long long) start->tv_sec * (long long) 1E9 + start->tv_nsec;
+}
+
+
 void PreciseTimer_report(struct PreciseTimer *timer) {
   struct timespec *start = &(timer->start_time);
   struct timespec *end = &(timer->end_time);
@@ -4,11 +4,25 @@
  * ID: 104853981
  */ 
 
+/** The default source is clock_gettime(CLOCK_MONOTONIC). After a
+ *  successful PreciseTimer_use_tsc(), start/end read the time-stamp
+ *  counter instead, which costs a few nanoseconds rather than a
+ *  vDSO call, and diff is converted to ns with a calibrated rate.
+ *  Only start_time or start_tsc is filled, depending on the source.
+ */
+
+enum timer_source {TIMER_CLOCK, TIMER_TSC};
+extern enum timer_source timer_source;
+
 struct PreciseTimer {
   struct timespec start_time;
   struct timespec end_time;
+  unsigned long long start_tsc;
+  unsigned long long end_tsc;
   long long diff;
 };
 
+int PreciseTimer_use_tsc(void);
 void PreciseTimer_start(struct PreciseTimer *timer);
 void PreciseTimer_end(struct PreciseTimer *timer);
+long long PreciseTimer_start_ns(struct PreciseTimer *timer);
@@ -0,0 +1,195 @@
+/*
+ * NAME: Jonathan Chang
+ * EMAIL: j.a.chang820@gmail.com
+ * ID: 104853981
+ */
+
+#include <errno.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "SortedList.h"
+#include "Snapshot.h"
+
+/* nodes are relocated in place, so they must match the element layout */
+typedef char snapshot_node_matches_element
+[sizeof(struct SnapshotNode) == sizeof(SortedListElement_t) ? 1 : -1];
+
+static char *mapping = NULL;
+static size_t mapping_size;
+
+
+static uint64_t node_size(const char *key) {
+  return (sizeof(struct SnapshotNode) + strlen(key) + 1 + 7) & ~(uint64_t) 7;
+}
+
+
+static void write_or_die(FILE *file, const void *data, size_t size,
+			 const char *file_name) {
+  if (size > 0 && fwrite(data, size, 1, file) != 1) {
+    fprintf(stderr, "Snapshot file %s could not be written.\r\n%s\r\n",
+	    file_name, strerror(errno));
+    exit(2);
+  }
+}
+
+
+static void corrupted(const char *file_name) {
+  fprintf(stderr, "Snapshot file %s is corrupted.\r\n", file_name);
+  exit(2);
+}
+
+
+/*! Writes the sublists as they are; no operation may be running. */
+void Snapshot_save(const char *file_name, SortedList_t *lists, int count) {
+  static const char padding[8];
+  struct SnapshotHeader header;
+  struct SnapshotNode node;
+  SortedListElement_t *el;
+  uint64_t *heads;
+  uint64_t offset, size, prev;
+  size_t key_size;
+  FILE *file;
+  int b;
+
+  /* first pass: where each list starts and how big the file is */
+  heads = calloc(count, sizeof(uint64_t));
+  if (heads == NULL) {
+    fprintf(stderr, "Insufficient memory for the snapshot.\r\n");
+    exit(2);
+  }
+  memcpy(header.magic, SNAPSHOT_MAGIC, sizeof(header.magic));
+  header.version = SNAPSHOT_VERSION;
+  header.lists = count;
+  header.reserved = 0;
+  header.elements = 0;
+  offset = sizeof(header) + count * sizeof(uint64_t);
+  for (b = 0; b < count; b++) {
+    if (lists[b].next != NULL)
+      heads[b] = offset;
+    for (el = lists[b].next; el != NULL; el = el->next) {
+      offset += node_size(el->key);
+      header.elements++;
+    }
+  }
+  header.size = offset;
+
+  file = fopen(file_name, "wb");
+  if (file == NULL) {
+    fprintf(stderr, "Snapshot file %s could not be opened.\r\n%s\r\n",
+	    file_name, strerror(errno));
+    exit(2);
+  }
+  write_or_die(file, &header, sizeof(header), file_name);
+  write_or_die(file, heads, count * sizeof(uint64_t), file_name);
+  free(heads);
+
+  /* second pass: the nodes, linked to their neighbours by offset */
+  offset = sizeof(header) + count * sizeof(uint64_t);
+  for (b = 0; b < count; b++) {
+    prev = 0;
+    for (el = lists[b].next; el != NULL; el = el->next) {
+      size = node_size(el->key);
+      key_size = strlen(el->key) + 1;
+      node.prev = prev;
+      node.next = (el->next != NULL) ? offset + size : 0;
+      node.key = offset + sizeof(node);
+      write_or_die(file, &node, sizeof(node), file_name);
+      write_or_die(file, el->key, key_size, file_name);
+      write_or_die(file, padding, size - sizeof(node) - key_size, file_name);
+      prev = offset;
+      offset += size;
+    }
+  }
+
+  if (fclose(file) != 0) {
+    fprintf(stderr, "Snapshot file %s could not be written.\r\n%s\r\n",
+	    file_name, strerror(errno));
+    exit(2);
+  }
+}
+
+
+/*! Maps a snapshot privately and links its nodes, in place, behind the
+ *  given (empty) list heads. Every list must be sorted and hold only
+ *  keys bin_of() puts in it, since nothing checks the lists again until
+ *  the timed run is over. Returns the number of elements. The nodes
+ *  live in the mapping until Snapshot_unload(). */
+long Snapshot_load(const char *file_name, SortedList_t *lists, int count,
+		   int (*bin_of)(const char*)) {
+  struct SnapshotHeader *header;
+  struct SnapshotNode *node;
+  SortedListElement_t *el, *prev;
+  uint64_t *heads;
+  uint64_t offset, next, key;
+  struct stat info;
+  long loaded = 0;
+  int fd, b;
+
+  fd = open(file_name, O_RDONLY);
+  if (fd == -1 || fstat(fd, &info) == -1) {
+    fprintf(stderr, "Snapshot file %s could not be opened.\r\n%s\r\n",
+	    file_name, strerror(errno));
+    exit(2);
+  }
+  if ((size_t) info.st_size < sizeof(struct SnapshotHeader))
+    corrupted(file_name);
+  mapping_size = info.st_size;
+  mapping = mmap(NULL, mapping_size, PROT_READ | PROT_WRITE, MAP_PRIVATE,
+		 fd, 0);
+  close(fd);
+  if (mapping == MAP_FAILED) {
+    mapping = NULL;
+    fprintf(stderr, "Snapshot file %s could not be mapped.\r\n%s\r\n",
+	    file_name, strerror(errno));
+    exit(2);
+  }
+
+  header = (struct SnapshotHeader*) mapping;
+  if (memcmp(header->magic, SNAPSHOT_MAGIC, sizeof(header->magic)) != 0 ||
+      header->version != SNAPSHOT_VERSION || header->size != mapping_size ||
+      sizeof(*header) + count * sizeof(uint64_t) > mapping_size)
+    corrupted(file_name);
+  if (header->lists != (uint32_t) count) {
+    fprintf(stderr, "Snapshot file %s holds %u sublists, not %d.\r\n",
+	    file_name, header->lists, count);
+    exit(2);
+  }
+
+  heads = (uint64_t*) (mapping + sizeof(*header));
+  for (b = 0; b < count; b++) {
+    prev = &lists[b];
+    for (offset = heads[b]; offset != 0; offset = next) {
+      if (offset % 8 != 0 || offset + sizeof(*node) > mapping_size ||
+	  ++loaded > (long) header->elements)
+	corrupted(file_name);
+      node = (struct SnapshotNode*) (mapping + offset);
+      next = node->next;
+      key = node->key;
+      if (key >= mapping_size ||
+	  memchr(mapping + key, '\0', mapping_size - key) == NULL)
+	corrupted(file_name);
+      if ((prev != &lists[b] && strcmp(prev->key, mapping + key) > 0) ||
+	  bin_of(mapping + key) != b)
+	corrupted(file_name);
+      el = (SortedListElement_t*) node;
+      el->key = mapping + key;
+      el->prev = prev;
+      el->next = NULL;
+      prev->next = el;
+      prev = el;
+    }
+  }
+  return loaded;
+}
+
+
+void Snapshot_unload(void) {
+  if (mapping != NULL)
+    munmap(mapping, mapping_size);
+  mapping = NULL;
+}
@@ -0,0 +1,49 @@
+/*
+ * NAME: Jonathan Chang
+ * EMAIL: j.a.chang820@gmail.com
+ * ID: 104853981
+ */ 
+
+/** Snapshots of populated sublists for --save and --load.
+ *
+ *  A snapshot stores each sublist in key order, with every link as a
+ *  byte offset into the file, so it does not depend on where it was
+ *  written from or is mapped to. Each node has the size and layout of
+ *  a SortedListElement (prev, next and key offsets), followed by its
+ *  key inline. Loading maps the file privately and turns the offsets
+ *  into pointers in one pass, in place, instead of inserting every
+ *  element again.
+ *
+ *  File layout:
+ *	struct SnapshotHeader
+ *	lists * uint64_t offset of each sublist's first node, 0 if empty
+ *	nodes, 8-byte aligned, each list's nodes in order
+ */
+
+#include <stdint.h>
+
+struct SortedListElement;
+
+#define SNAPSHOT_MAGIC "L2BS"
+#define SNAPSHOT_VERSION 1
+
+struct SnapshotHeader {
+  char magic[4];
+  uint32_t version;
+  uint32_t lists;
+  uint32_t reserved;
+  uint64_t elements;
+  uint64_t size;      /* of the whole file */
+};
+
+struct SnapshotNode {
+  uint64_t prev;      /* offset of the previous node, 0 after the head */
+  uint64_t next;      /* offset of the next node, 0 at the end */
+  uint64_t key;       /* offset of the key, just past this node */
+};
+
+void Snapshot_save(const char *file_name, struct SortedListElement *lists,
+		   int count);
+long Snapshot_load(const char *file_name, struct SortedListElement *lists,
+		   int count, int (*bin_of)(const char*));
+void Snapshot_unload(void);
@@ -10,14 +10,27 @@
 #include <limits.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <stdint.h>
+#include <time.h>
 #include "PreciseTimer.h"
 #include "ListInfo.h"
+#include "AdaptiveLock.h"
+#include "ChromeTrace.h"
 
-enum sync_options {UNSYNCED, MUTEX, SPINLOCK} sync_opt = UNSYNCED;
+enum sync_options {UNSYNCED, MUTEX, SPINLOCK, ADAPTIVE} sync_opt = UNSYNCED;
 pthread_mutex_t *mutex;
 int *spinlock;
+struct AdaptiveLock *adaptive;
 int opt_yield = 0;
 long num_elements = (long)1E7;
+static long list_limit = (long)1E7;  /* longest list a traversal accepts */
+long sample_period = 1;
+int prefetch_distance = 0;
+int opt_deferred = 0;
+static __thread long sample_count = 0;
+
+/* set in an element's prev pointer by a deferred delete */
+#define DELETE_MARK ((uintptr_t) 1)
 
 
 int yield_by(char* yield) {
@@ -49,6 +62,9 @@ int sync_by(char sync) {
   else if (sync == 's') {
     sync_opt = SPINLOCK;
   }
+  else if (sync == 'f') {
+    sync_opt = ADAPTIVE;
+  }
   else {
     return 1; /* error */
   }
@@ -60,9 +76,15 @@ void initialize_sync(int sublists) {
   num_lists = sublists;
   mutex = malloc(num_lists * sizeof(pthread_mutex_t));
   spinlock = malloc(num_lists * sizeof(int));
+  if (posix_memalign((void**) &adaptive, CACHE_LINE_SIZE,
+		     num_lists * sizeof(struct AdaptiveLock)) != 0) {
+    fprintf(stderr, "Insufficient memory for adaptive locks.\r\n");
+    exit(2);
+  }
   for (n = 0; n < num_lists; n++) {
     pthread_mutex_init(&mutex[n], NULL);
     spinlock[n] = 0;
+    AdaptiveLock_init(&adaptive[n]);
   }
 }
 
@@ -73,155 +95,845 @@ void destroy_sync() {
   }
   free(mutex);
   free(spinlock);
+  free(adaptive);
 }
 
+/*! Sets how many elements a sublist may hold before a traversal treats
+    it as a loop. */
 void limit_iterations(long elements) {
-  num_elements = elements;
+  list_limit = elements;
 }
 
-void set_lock(int bin, long long *lock_time) {
-  struct PreciseTimer timer;
-  PreciseTimer_start(&timer);
+static void acquire_lock(int bin) {
   if (sync_opt == MUTEX) pthread_mutex_lock(&mutex[bin]);
   if (sync_opt == SPINLOCK)
     while (__sync_lock_test_and_set(&spinlock[bin], 1))
       ;
-  PreciseTimer_end(&timer);
-  if (sync_opt == UNSYNCED) {
-    *lock_time = 0;
-  }
-  else {
-    *lock_time = timer.diff;
+  if (sync_opt == ADAPTIVE) AdaptiveLock_lock(&adaptive[bin]);
+}
+
+/*! Only 1 in sample_period acquisitions is timed, and its wait is
+    scaled by sample_period so the summed wait stays an estimate of
+    the total. Unsynchronized runs have nothing to wait for and skip
+    the timer. */
+void set_lock(int bin, long long *lock_time) {
+  struct PreciseTimer timer;
+  *lock_time = 0;
+  if (sync_opt == UNSYNCED) return;
+  if (++sample_count < sample_period) {
+    acquire_lock(bin);
+    return;
   }
+  sample_count = 0;
+  PreciseTimer_start(&timer);
+  acquire_lock(bin);
+  PreciseTimer_end(&timer);
+  *lock_time = timer.diff * sample_period;
+  if (trace_enabled && timer.diff >= trace_threshold)
+    ChromeTrace_span("lock wait", &timer, bin);
 }
 
 void release_lock(int bin) {
   if (sync_opt == MUTEX) pthread_mutex_unlock(&mutex[bin]);
   if (sync_opt == SPINLOCK) __sync_lock_release(&spinlock[bin]);
+  if (sync_opt == ADAPTIVE) AdaptiveLock_unlock(&adaptive[bin]);
 }
 
-void SortedList_insert(SortedList_t *list, SortedListElement_t *element) {
+/*! Starts a runner prefetch_distance links past it, or returns NULL
+    when prefetching is off. The specialized copies built with
+    SL_PREFETCH 1 only run when the distance is non-zero; the deferred
+    operations, which are not specialized, rely on the check here. */
+static inline SortedListElement_t *prefetch_start(SortedListElement_t *it) {
+  int d;
+  if (prefetch_distance == 0) return NULL;
+  for (d = 0; d < prefetch_distance && it != NULL; d++) {
+    __builtin_prefetch(it->key);
+    it = it->next;
+  }
+  return it;
+}
+
+/*! Moves the runner one link. It prefetches the node one past itself,
+    so that node is requested distance + 1 links before the traversal
+    reaches it, and the runner's own key. */
+static inline SortedListElement_t *prefetch_step(SortedListElement_t *ahead) {
+  if (ahead == NULL) return NULL;
+  __builtin_prefetch(ahead->next);
+  __builtin_prefetch(ahead->key);
+  return ahead->next;
+}
+
+
+enum lookup_stage {LOOKUP_NODE, LOOKUP_KEY, LOOKUP_DONE};
+
+struct LookupState {
+  SortedListElement_t *node;  /* node being compared */
+  enum lookup_stage stage;
+  long limiter;
+};
+
+void SortedList_lookup_batch(SortedList_t **lists, const char **keys,
+			     SortedListElement_t **results, int count) {
+  struct LookupState state[SORTEDLIST_MAX_BATCH];
+  int bins[SORTEDLIST_MAX_BATCH];
+  struct ListInfo *sList;
+  struct LookupState *s;
+  long long lock_time, total_time = 0;
+  int num_bins = 0;
+  int remaining = count;
+  int k, b, bin;
+
+  /* sorted distinct sublists, so that batches sharing sublists always
+     take their locks in the same order */
+  for (k = 0; k < count; k++) {
+    bin = ((struct ListInfo*) lists[k])->bin;
+    for (b = 0; b < num_bins && bins[b] < bin; b++)
+      ;
+    if (b < num_bins && bins[b] == bin) continue;
+    memmove(&bins[b + 1], &bins[b], (num_bins - b) * sizeof(int));
+    bins[b] = bin;
+    num_bins++;
+  }
+  for (b = 0; b < num_bins; b++) {
+    set_lock(bins[b], &lock_time);
+    total_time += lock_time;
+  }
+
+  for (k = 0; k < count; k++) {
+    sList = (struct ListInfo*) lists[k];
+    sList->timer = 0;
+    results[k] = NULL;
+    state[k].node = ((SortedListElement_t*) sList->list_obj)->next;
+    state[k].limiter = 0;
+    state[k].stage = LOOKUP_NODE;
+    if (state[k].node == NULL) {
+      state[k].stage = LOOKUP_DONE;
+      remaining--;
+    }
+    else __builtin_prefetch(state[k].node);
+  }
+  ((struct ListInfo*) lists[0])->timer = total_time;
+
+  /* by the time a lookup comes round again, what it prefetched on its
+     last step should have arrived */
+  while (remaining > 0) {
+    for (k = 0; k < count; k++) {
+      s = &state[k];
+      switch (s->stage) {
+      case LOOKUP_NODE:
+	__builtin_prefetch(s->node->key);
+	__builtin_prefetch(s->node->key + CACHE_LINE_SIZE);
+	s->stage = LOOKUP_KEY;
+	break;
+      case LOOKUP_KEY:
+	if (strcmp(s->node->key, keys[k]) == 0 &&
+	    ((uintptr_t) s->node->prev & DELETE_MARK) == 0) {
+	  results[k] = s->node;
+	  s->stage = LOOKUP_DONE;
+	  remaining--;
+	  break;
+	}
+	s->node = s->node->next;
+	if (s->node == NULL || ++s->limiter >= list_limit) {
+	  s->stage = LOOKUP_DONE; /* not found, or prevent infinite loops */
+	  remaining--;
+	  break;
+	}
+	__builtin_prefetch(s->node);
+	s->stage = LOOKUP_NODE;
+	break;
+      case LOOKUP_DONE:
+	break;
+      }
+    }
+  }
+
+  if (opt_yield & LOOKUP_YIELD)
+    sched_yield();
+
+  for (b = num_bins - 1; b >= 0; b--)
+    release_lock(bins[b]);
+}
+
+
+/* Deferred unlinking. Delete only sets DELETE_MARK in the element's
+   prev pointer, with a compare-and-swap and no lock, and a maintenance
+   thread unlinks every marked element in one locked pass per sublist.
+   Because the mark can appear at any time, every other store to a
+   prev pointer is a compare-and-swap that keeps it. Each mark also
+   counts toward its sublist's pending total, so the maintenance thread
+   only locks and walks sublists that have something to unlink.
+   DELETE_MARK is defined at the top for SortedList_lookup_batch. */
+static SortedList_t *unlink_lists;
+static long *unlink_pending;  /* marks not yet unlinked, per sublist */
+static int unlink_count;
+static int unlink_stop;
+static pthread_t unlinker;
+
+static inline int is_marked(SortedListElement_t *el) {
+  return ((uintptr_t) __atomic_load_n(&el->prev, __ATOMIC_ACQUIRE) &
+	  DELETE_MARK) != 0;
+}
+
+static inline SortedListElement_t *unmarked(SortedListElement_t *prev) {
+  return (SortedListElement_t*) ((uintptr_t) prev & ~DELETE_MARK);
+}
+
+/*! Points el->prev at prev without losing el's mark. */
+static void set_prev(SortedListElement_t *el, SortedListElement_t *prev) {
+  SortedListElement_t *old = __atomic_load_n(&el->prev, __ATOMIC_RELAXED);
+  SortedListElement_t *new;
+  do {
+    new = (SortedListElement_t*) ((uintptr_t) prev |
+				  ((uintptr_t) old & DELETE_MARK));
+  } while (!__atomic_compare_exchange_n(&el->prev, &old, new, 0,
+					__ATOMIC_RELEASE, __ATOMIC_RELAXED));
+}
+
+/*! Unlinks a marked element; its sublist must be locked. Clearing prev
+    last makes the element free to be inserted again. */
+static void unlink_element(SortedListElement_t *el) {
+  SortedListElement_t *prev = unmarked(el->prev);
+  prev->next = el->next;
+  if (el->next != NULL)
+    set_prev(el->next, prev);
+  el->next = NULL;
+  __atomic_store_n(&el->prev, NULL, __ATOMIC_RELEASE);
+}
+
+/*! Records a new mark in bin for the unlinker. */
+static inline void add_pending(int bin) {
+  if (unlink_pending != NULL)
+    __atomic_fetch_add(&unlink_pending[bin], 1, __ATOMIC_RELEASE);
+}
+
+static void deferred_insert(SortedList_t *list, SortedListElement_t *element) {
   struct ListInfo *sList = (struct ListInfo*) list;
   SortedListElement_t *it = (SortedListElement_t*) sList->list_obj;
+  SortedListElement_t *ahead;
   int limiter = 0;
   int bin = sList->bin;
 
   set_lock(bin, &(sList->timer));
 
+  if (element->prev != NULL)    /* deleted, but not unlinked yet */
+    unlink_element(element);
+
+  ahead = prefetch_start(it);
   while (it->next != NULL && strcmp(it->next->key, element->key) < 0) {
-    if (limiter >= num_elements) break; /* prevent infinite loops */
+    if (limiter >= list_limit) break; /* prevent infinite loops */
     it = it->next;
+    ahead = prefetch_step(ahead);
     limiter++;
   }
 
   if (opt_yield & INSERT_YIELD)
     sched_yield();
 
-  if (limiter <= num_elements) {
-    if (it->next == NULL || limiter == num_elements) { /* end of list */
-      element->next = NULL; 
-    }
-    else {
-      it->next->prev = element;
-      element->next = it->next;
-    }
-    element->prev = it;
-    it->next = element;
-  }
+  element->next = it->next;
+  __atomic_store_n(&element->prev, it, __ATOMIC_RELAXED);
+  if (it->next != NULL)
+    set_prev(it->next, element);
+  it->next = element;
 
   release_lock(bin);
 }
 
-
-int SortedList_delete(SortedListElement_t *element) {
+/*! Marks the element deleted without taking the sublist lock. Fails
+    for the head, an element in no list, or one already deleted. */
+static int deferred_delete(SortedListElement_t *element) {
   struct ListInfo *sList = (struct ListInfo*) element;
   SortedListElement_t *el = (SortedListElement_t*) sList->list_obj;
-  int bin = sList->bin;
-  set_lock(bin, &(sList->timer));
-
-  if (el->prev == NULL)            /* head cannot be deleted or */
-    return 1;
-  if (el->prev->next != el)        /* list is corrupted */
-    return 1;
-  if (el->next != NULL &&
-      el->next->prev != el)
-    return 1;
+  SortedListElement_t *prev = __atomic_load_n(&el->prev, __ATOMIC_RELAXED);
+  sList->timer = 0;
 
   if (opt_yield & DELETE_YIELD)
     sched_yield();
 
-  if (el->next == NULL) {          /* last element in list       */
-    el->prev->next = NULL;
-  }
-  else {
-    el->prev->next = el->next;
-    el->next->prev = el->prev;
+  do {
+    if (prev == NULL || ((uintptr_t) prev & DELETE_MARK))
+      return 1;
+  } while (!__atomic_compare_exchange_n(&el->prev, &prev,
+					(SortedListElement_t*)
+					((uintptr_t) prev | DELETE_MARK), 0,
+					__ATOMIC_RELEASE, __ATOMIC_RELAXED));
+  add_pending(sList->bin);
+  return 0;
+}
+
+static SortedListElement_t *deferred_lookup(SortedList_t *list,
+					    const char *key) {
+  struct ListInfo *sList = (struct ListInfo*) list;
+  SortedListElement_t *it = (SortedListElement_t*) sList->list_obj;
+  SortedListElement_t *ahead;
+  SortedListElement_t *result = NULL;
+  int bin = sList->bin;
+  int limiter = 0;
+
+  set_lock(bin, &(sList->timer));
+
+  ahead = prefetch_start(it);
+  while (it->next != NULL && limiter < list_limit) {
+    if (strcmp(it->next->key, key) == 0 && !is_marked(it->next)) {
+      result = it->next;
+      break;
+    }
+    it = it->next;
+    ahead = prefetch_step(ahead);
+    limiter++;
   }
 
+  if (opt_yield & LOOKUP_YIELD)
+    sched_yield();
+
   release_lock(bin);
 
-  el->next = NULL;
-  el->prev = NULL;
-  return 0;
+  return result;
 }
 
-
-SortedListElement_t *SortedList_lookup(SortedList_t *list, const char *key) {
+/*! Marks the first unmarked element holding key. The lock only keeps
+    the unlinker away while the element is found. */
+static int deferred_remove_key(SortedList_t *list, const char *key) {
   struct ListInfo *sList = (struct ListInfo*) list;
   SortedListElement_t *it = (SortedListElement_t*) sList->list_obj;
+  SortedListElement_t *ahead;
+  SortedListElement_t *el = NULL;
+  SortedListElement_t *prev;
   int bin = sList->bin;
-  SortedListElement_t *result;
   int limiter = 0;
 
   set_lock(bin, &(sList->timer));
 
-  while (it->next != NULL && strcmp(it->next->key, key) != 0) {
-    if (limiter >= num_elements) break; /* prevent infinite loops */
+  ahead = prefetch_start(it);
+  while (it->next != NULL && limiter < list_limit) {
+    if (strcmp(it->next->key, key) == 0 && !is_marked(it->next)) {
+      el = it->next;
+      break;
+    }
     it = it->next;
+    ahead = prefetch_step(ahead);
     limiter++;
   }
 
-  if (opt_yield & LOOKUP_YIELD)
+  if (opt_yield & (LOOKUP_YIELD | DELETE_YIELD))
     sched_yield();
 
-  if (limiter <= num_elements) {
-    if (it->next == NULL || limiter == num_elements) 
-      result = NULL;
-    else result = it->next;
+  if (el != NULL) {
+    prev = __atomic_load_n(&el->prev, __ATOMIC_RELAXED);
+    do {
+      if ((uintptr_t) prev & DELETE_MARK) {  /* a delete got there first */
+	el = NULL;
+	break;
+      }
+    } while (!__atomic_compare_exchange_n(&el->prev, &prev,
+					  (SortedListElement_t*)
+					  ((uintptr_t) prev | DELETE_MARK), 0,
+					  __ATOMIC_RELEASE, __ATOMIC_RELAXED));
+    if (el != NULL)
+      add_pending(bin);
   }
-  else result = NULL;
 
   release_lock(bin);
 
-  return result;
+  return (el == NULL) ? -1 : 0;
 }
 
-
-int SortedList_length(SortedList_t *list) {
+/*! Counts the elements not marked deleted. */
+static int deferred_length(SortedList_t *list) {
   struct ListInfo *sList = (struct ListInfo*) list;
   SortedListElement_t *it = (SortedListElement_t*) sList->list_obj;
+  SortedListElement_t *ahead;
   int bin = sList->bin;
   int limiter = 0;
+  int count = 0;
 
   if (opt_yield & LOOKUP_YIELD)
     sched_yield();
 
   set_lock(bin, &(sList->timer));
 
+  ahead = prefetch_start(it);
   while (it->next != NULL) {
-    if (it->next->prev != it) { /* list corrupted */
-      limiter = -1;
-      break;
-    }
-    if (limiter >= num_elements ) { /* prevent infinite loop */
-      limiter = -1;
+    if (unmarked(it->next->prev) != it ||  /* list corrupted */
+	limiter >= list_limit) {         /* prevent infinite loop */
+      count = -1;
       break;
     }
+    if (!is_marked(it->next))
+      count++;
     limiter++;
     it = it->next;
+    ahead = prefetch_step(ahead);
   }
 
   release_lock(bin);
 
-  return limiter;
+  return count;
+}
+
+static const struct SortedListOps deferred_ops = {
+  deferred_insert,
+  deferred_delete,
+  deferred_lookup,
+  deferred_length,
+  deferred_remove_key
+};
+
+/*! One locked pass over a sublist, unlinking every marked element. */
+static int unlink_pass(int bin) {
+  SortedListElement_t *it = &unlink_lists[bin];
+  SortedListElement_t *node;
+  int unlinked = 0;
+
+  /* a mark is counted just after it is set, so a sweep can unlink it
+     first and leave the total briefly negative */
+  if (__atomic_load_n(&unlink_pending[bin], __ATOMIC_ACQUIRE) <= 0)
+    return 0;
+
+  acquire_lock(bin);
+  while ((node = it->next) != NULL) {
+    if (is_marked(node)) {
+      unlink_element(node);
+      unlinked++;
+    }
+    else it = node;
+  }
+  release_lock(bin);
+  __atomic_fetch_sub(&unlink_pending[bin], unlinked, __ATOMIC_RELEASE);
+  return unlinked;
+}
+
+/*! Sweeps the sublists until stopped, resting briefly after a sweep
+    that found nothing to unlink. */
+static void *unlinker_main(void *arg) {
+  struct timespec idle = {0, 100000};
+  int unlinked;
+  int bin;
+  (void) arg;
+  while (!__atomic_load_n(&unlink_stop, __ATOMIC_ACQUIRE)) {
+    unlinked = 0;
+    for (bin = 0; bin < unlink_count; bin++)
+      unlinked += unlink_pass(bin);
+    if (unlinked == 0)
+      nanosleep(&idle, NULL);
+  }
+  return NULL;
+}
+
+void SortedList_start_unlinker(SortedList_t *lists, int count) {
+  unlink_lists = lists;
+  unlink_count = count;
+  unlink_stop = 0;
+  unlink_pending = calloc(count, sizeof(long));
+  if (unlink_pending == NULL) {
+    fprintf(stderr, "Insufficient memory for the unlink counts.\r\n");
+    exit(2);
+  }
+  if (pthread_create(&unlinker, NULL, unlinker_main, NULL) != 0) {
+    fprintf(stderr, "Unlink thread could not be created.\r\n");
+    exit(2);
+  }
+}
+
+void SortedList_stop_unlinker(void) {
+  int bin;
+  __atomic_store_n(&unlink_stop, 1, __ATOMIC_RELEASE);
+  pthread_join(unlinker, NULL);
+  for (bin = 0; bin < unlink_count; bin++) /* whatever the last sweep missed */
+    unlink_pass(bin);
+  free(unlink_pending);
+  unlink_pending = NULL;
+}
+
+
+/* Pop-min over an array of lists used as one priority queue, with the
+   elements spread over the lists regardless of key. */
+
+static __thread unsigned int pop_seed = 0;
+
+/*! xorshift32; each thread seeds from the address of its own seed. */
+static unsigned int pop_random(void) {
+  if (pop_seed == 0)
+    pop_seed = (unsigned int) (uintptr_t) &pop_seed | 1;
+  pop_seed ^= pop_seed << 13;
+  pop_seed ^= pop_seed >> 17;
+  pop_seed ^= pop_seed << 5;
+  return pop_seed;
+}
+
+/*! Unlinks the first element of a locked list, or returns NULL. */
+static SortedListElement_t *pop_head(SortedList_t *head) {
+  SortedListElement_t *first = head->next;
+  if (first == NULL)
+    return NULL;
+
+  if (opt_yield & DELETE_YIELD)
+    sched_yield();
+
+  head->next = first->next;
+  if (first->next != NULL)
+    first->next->prev = head;
+  first->next = NULL;
+  first->prev = NULL;
+  return first;
+}
+
+/*! Holds every list's lock, lowest first, to find the true minimum. */
+static SortedListElement_t *pop_strict(SortedList_t *lists, int count,
+				       long long *lock_time) {
+  SortedListElement_t *min = NULL;
+  long long wait;
+  int min_list = 0;
+  int b;
+
+  for (b = 0; b < count; b++) {
+    set_lock(b, &wait);
+    *lock_time += wait;
+  }
+  for (b = 0; b < count; b++) {
+    if (lists[b].next != NULL &&
+	(min == NULL || strcmp(lists[b].next->key, min->key) < 0)) {
+      min = lists[b].next;
+      min_list = b;
+    }
+  }
+  if (min != NULL)
+    pop_head(&lists[min_list]);
+  for (b = count - 1; b >= 0; b--)
+    release_lock(b);
+  return min;
+}
+
+/*! MultiQueue: peek at the heads of two random lists without locking,
+    then lock and pop the one with the smaller key. The heads stay
+    readable after a concurrent pop, since elements are never freed
+    during a run. */
+static SortedListElement_t *pop_relaxed(SortedList_t *lists, int count,
+					long long *lock_time) {
+  SortedListElement_t *first, *other;
+  long long wait;
+  int a, b;
+
+  for (;;) {
+    a = pop_random() % count;
+    b = pop_random() % count;
+    first = __atomic_load_n(&lists[a].next, __ATOMIC_ACQUIRE);
+    other = __atomic_load_n(&lists[b].next, __ATOMIC_ACQUIRE);
+    if (first == NULL ||
+	(other != NULL && strcmp(other->key, first->key) < 0)) {
+      a = b;
+      first = other;
+    }
+    if (first == NULL)  /* both looked empty */
+      break;
+    set_lock(a, &wait);
+    *lock_time += wait;
+    first = pop_head(&lists[a]);
+    release_lock(a);
+    if (first != NULL)
+      return first;
+  }
+
+  /* take any head rather than report empty on two samples */
+  for (b = 0; b < count; b++) {
+    set_lock(b, &wait);
+    *lock_time += wait;
+    first = pop_head(&lists[b]);
+    release_lock(b);
+    if (first != NULL)
+      return first;
+  }
+  return NULL;
+}
+
+SortedListElement_t *SortedList_pop_min(SortedList_t *lists, int count,
+					int relaxed, long long *lock_time) {
+  *lock_time = 0;
+  if (relaxed)
+    return pop_relaxed(lists, count, lock_time);
+  return pop_strict(lists, count, lock_time);
+}
+
+
+/* Bulk loading: sort pointers to the elements with a parallel merge
+   sort, then link them in with one merge pass per list. */
+
+struct SortTask {
+  SortedListElement_t **items;
+  SortedListElement_t **scratch;
+  long lo, mid, hi;
+};
+
+static int compare_keys(const void *a, const void *b) {
+  return strcmp((*(SortedListElement_t* const*) a)->key,
+		(*(SortedListElement_t* const*) b)->key);
+}
+
+static void *sort_run(void *arg) {
+  struct SortTask *task = (struct SortTask*) arg;
+  qsort(task->items + task->lo, task->hi - task->lo,
+	sizeof(SortedListElement_t*), compare_keys);
+  return NULL;
+}
+
+static void *merge_runs(void *arg) {
+  struct SortTask *task = (struct SortTask*) arg;
+  long a = task->lo, b = task->mid, out = task->lo;
+  while (a < task->mid && b < task->hi)
+    task->scratch[out++] = (compare_keys(&task->items[b],
+					 &task->items[a]) < 0) ?
+      task->items[b++] : task->items[a++];
+  while (a < task->mid)
+    task->scratch[out++] = task->items[a++];
+  while (b < task->hi)
+    task->scratch[out++] = task->items[b++];
+  memcpy(task->items + task->lo, task->scratch + task->lo,
+	 (task->hi - task->lo) * sizeof(SortedListElement_t*));
+  return NULL;
+}
+
+/*! Runs every task on its own thread, the first on the caller's. */
+static void run_tasks(void *(*work)(void*), struct SortTask *tasks,
+		      int count) {
+  pthread_t threads[count];
+  int t;
+  for (t = 1; t < count; t++) {
+    if (pthread_create(&threads[t], NULL, work, &tasks[t]) != 0) {
+      fprintf(stderr, "Bulk load thread could not be created.\r\n");
+      exit(2);
+    }
+  }
+  work(&tasks[0]);
+  for (t = 1; t < count; t++)
+    pthread_join(threads[t], NULL);
+}
+
+void SortedList_bulk_load(SortedList_t *lists, int count,
+			  SortedListElement_t *elements, long n,
+			  int (*list_of)(const char*), int threads) {
+  SortedListElement_t **items, **scratch, **cursor;
+  SortedListElement_t *el, *it;
+  struct SortTask *tasks;
+  long *bounds;
+  long i;
+  int runs, width, r, t;
+
+  if (n <= 0)
+    return;
+  runs = (threads < 1) ? 1 : threads;
+  if (runs > n)
+    runs = n;
+  items = malloc(n * sizeof(SortedListElement_t*));
+  scratch = malloc(n * sizeof(SortedListElement_t*));
+  tasks = malloc(runs * sizeof(struct SortTask));
+  bounds = malloc((runs + 1) * sizeof(long));
+  cursor = malloc(count * sizeof(SortedListElement_t*));
+  if (items == NULL || scratch == NULL || tasks == NULL || bounds == NULL ||
+      cursor == NULL) {
+    fprintf(stderr, "Insufficient memory for bulk load.\r\n");
+    exit(2);
+  }
+  for (i = 0; i < n; i++)
+    items[i] = &elements[i];
+
+  /* one run per thread, then rounds of pairwise merges */
+  for (r = 0; r <= runs; r++)
+    bounds[r] = r * n / runs;
+  for (r = 0; r < runs; r++) {
+    tasks[r].items = items;
+    tasks[r].lo = bounds[r];
+    tasks[r].hi = bounds[r + 1];
+  }
+  run_tasks(sort_run, tasks, runs);
+  for (width = 1; width < runs; width *= 2) {
+    t = 0;
+    for (r = 0; r + width < runs; r += 2 * width) {
+      tasks[t].items = items;
+      tasks[t].scratch = scratch;
+      tasks[t].lo = bounds[r];
+      tasks[t].mid = bounds[r + width];
+      tasks[t].hi = bounds[(r + 2 * width < runs) ? r + 2 * width : runs];
+      t++;
+    }
+    run_tasks(merge_runs, tasks, t);
+  }
+
+  /* merge into each list, resuming after the last element placed */
+  for (t = 0; t < count; t++)
+    cursor[t] = &lists[t];
+  for (i = 0; i < n; i++) {
+    el = items[i];
+    t = list_of(el->key);
+    it = cursor[t];
+    while (it->next != NULL && strcmp(it->next->key, el->key) < 0)
+      it = it->next;
+    el->next = it->next;
+    el->prev = it;
+    if (it->next != NULL)
+      it->next->prev = el;
+    it->next = el;
+    cursor[t] = el;
+  }
+
+  free(items);
+  free(scratch);
+  free(tasks);
+  free(bounds);
+  free(cursor);
+}
+
+
+/* Specialized copies of the operations, one per sync mode, with and
+   without yields, and with and without the prefetch runner. The SL_
+   values mirror enum sync_options so the template can test them with
+   #if. */
+#define SL_UNSYNCED 0
+#define SL_MUTEX 1
+#define SL_SPINLOCK 2
+#define SL_ADAPTIVE 3
+
+#define SL_SYNC SL_UNSYNCED
+#define SL_TAG none
+#define SL_YIELD 0
+#define SL_PREFETCH 0
+#include "SortedListTemplate.h"
+
+#define SL_SYNC SL_UNSYNCED
+#define SL_TAG none
+#define SL_YIELD 0
+#define SL_PREFETCH 1
+#include "SortedListTemplate.h"
+
+#define SL_SYNC SL_UNSYNCED
+#define SL_TAG none
+#define SL_YIELD 1
+#define SL_PREFETCH 0
+#include "SortedListTemplate.h"
+
+#define SL_SYNC SL_UNSYNCED
+#define SL_TAG none
+#define SL_YIELD 1
+#define SL_PREFETCH 1
+#include "SortedListTemplate.h"
+
+#define SL_SYNC SL_MUTEX
+#define SL_TAG m
+#define SL_YIELD 0
+#define SL_PREFETCH 0
+#include "SortedListTemplate.h"
+
+#define SL_SYNC SL_MUTEX
+#define SL_TAG m
+#define SL_YIELD 0
+#define SL_PREFETCH 1
+#include "SortedListTemplate.h"
+
+#define SL_SYNC SL_MUTEX
+#define SL_TAG m
+#define SL_YIELD 1
+#define SL_PREFETCH 0
+#include "SortedListTemplate.h"
+
+#define SL_SYNC SL_MUTEX
+#define SL_TAG m
+#define SL_YIELD 1
+#define SL_PREFETCH 1
+#include "SortedListTemplate.h"
+
+#define SL_SYNC SL_SPINLOCK
+#define SL_TAG s
+#define SL_YIELD 0
+#define SL_PREFETCH 0
+#include "SortedListTemplate.h"
+
+#define SL_SYNC SL_SPINLOCK
+#define SL_TAG s
+#define SL_YIELD 0
+#define SL_PREFETCH 1
+#include "SortedListTemplate.h"
+
+#define SL_SYNC SL_SPINLOCK
+#define SL_TAG s
+#define SL_YIELD 1
+#define SL_PREFETCH 0
+#include "SortedListTemplate.h"
+
+#define SL_SYNC SL_SPINLOCK
+#define SL_TAG s
+#define SL_YIELD 1
+#define SL_PREFETCH 1
+#include "SortedListTemplate.h"
+
+#define SL_SYNC SL_ADAPTIVE
+#define SL_TAG f
+#define SL_YIELD 0
+#define SL_PREFETCH 0
+#include "SortedListTemplate.h"
+
+#define SL_SYNC SL_ADAPTIVE
+#define SL_TAG f
+#define SL_YIELD 0
+#define SL_PREFETCH 1
+#include "SortedListTemplate.h"
+
+#define SL_SYNC SL_ADAPTIVE
+#define SL_TAG f
+#define SL_YIELD 1
+#define SL_PREFETCH 0
+#include "SortedListTemplate.h"
+
+#define SL_SYNC SL_ADAPTIVE
+#define SL_TAG f
+#define SL_YIELD 1
+#define SL_PREFETCH 1
+#include "SortedListTemplate.h"
+
+
+/* Starts out as the copy for the default options (no sync, no yields,
+   no prefetch), so the SortedList_* interface works before
+   SortedList_select_ops(). */
+struct SortedListOps SortedList_ops = {
+  insert_none_0_0,
+  delete_none_0_0,
+  lookup_none_0_0,
+  length_none_0_0,
+  remove_key_none_0_0
+};
+
+void SortedList_select_ops(void) {
+  static const struct SortedListOps *table[][2][2] = {
+    [UNSYNCED] = {{&ops_none_0_0, &ops_none_0_1},
+		  {&ops_none_1_0, &ops_none_1_1}},
+    [MUTEX]    = {{&ops_m_0_0, &ops_m_0_1}, {&ops_m_1_0, &ops_m_1_1}},
+    [SPINLOCK] = {{&ops_s_0_0, &ops_s_0_1}, {&ops_s_1_0, &ops_s_1_1}},
+    [ADAPTIVE] = {{&ops_f_0_0, &ops_f_0_1}, {&ops_f_1_0, &ops_f_1_1}}
+  };
+  if (opt_deferred)
+    SortedList_ops = deferred_ops;
+  else
+    SortedList_ops =
+      *table[sync_opt][opt_yield != 0][prefetch_distance > 0];
+}
+
+
+/* The SortedList_* interface calls through whichever copy
+   SortedList_select_ops() chose last. */
+void SortedList_insert(SortedList_t *list, SortedListElement_t *element) {
+  SortedList_ops.insert(list, element);
+}
+
+int SortedList_delete(SortedListElement_t *element) {
+  return SortedList_ops.delete(element);
+}
+
+SortedListElement_t *SortedList_lookup(SortedList_t *list, const char *key) {
+  return SortedList_ops.lookup(list, key);
+}
+
+int SortedList_remove_key(SortedList_t *list, const char *key) {
+  return SortedList_ops.remove_key(list, key);
+}
+
+int SortedList_length(SortedList_t *list) {
+  return SortedList_ops.length(list);
 }
@@ -59,6 +59,21 @@ int SortedList_delete( SortedListElement_t *element);
  */
 SortedListElement_t *SortedList_lookup(SortedList_t *list, const char *key);
 
+/**
+ * SortedList_remove_key ... find an element by key and remove it
+ *
+ *	Does the work of SortedList_lookup followed by SortedList_delete
+ *	in one traversal, under one acquisition of the list's lock, so
+ *	no other operation can run between finding and unlinking.
+ *
+ * @param SortedList_t *list ... header for the list
+ * @param const char * key ... the key of the element to remove
+ *
+ * @return 0: element removed, 1: corrupted prev/next pointers,
+ *	   -1: no element has the key
+ */
+int SortedList_remove_key(SortedList_t *list, const char *key);
+
 /**
  * SortedList_length ... count elements in a sorted list
  *	While enumeratign list, it checks all prev/next pointers
@@ -70,6 +85,62 @@ SortedListElement_t *SortedList_lookup(SortedList_t *list, const char *key);
  */
 int SortedList_length(SortedList_t *list);
 
+/**
+ * SortedList_lookup_batch ... search for several keys at once
+ *
+ *	The lookups run as interleaved state machines. Each step of one
+ *	lookup prefetches the next node or key it needs and then moves
+ *	on to the next lookup, so up to count cache misses are in flight
+ *	instead of one. Each distinct sublist is locked once for the
+ *	whole batch, lowest sublist first.
+ *
+ * @param SortedList_t **lists ... header (ListInfo) for each lookup;
+ *	the batch's total lock wait is stored in the first one's timer
+ * @param const char **keys ... the desired key for each lookup
+ * @param SortedListElement_t **results ... matching element for each
+ *	lookup, or NULL if none is found
+ * @param int count ... number of lookups, 1 to SORTEDLIST_MAX_BATCH
+ */
+#define SORTEDLIST_MAX_BATCH 64
+void SortedList_lookup_batch(SortedList_t **lists, const char **keys,
+			     SortedListElement_t **results, int count);
+
+/**
+ * SortedList_pop_min ... remove the element with the smallest key
+ *
+ *	The count lists, whose locks are numbered 0 to count-1, are used
+ *	as one priority queue, and an element may be in any of them.
+ *	Strict mode locks every list and pops the smallest head, so all
+ *	callers serialize. Relaxed mode (MultiQueue) compares the heads
+ *	of two random lists and pops the smaller: the result is only
+ *	near the minimum, but callers rarely want the same lock.
+ *
+ * @param SortedList_t *lists ... array of count list headers
+ * @param int relaxed ... 0 for strict, 1 for relaxed
+ * @param long long *lock_time ... receives the time spent on locks
+ *
+ * @return the removed element, or NULL if every list is empty
+ */
+SortedListElement_t *SortedList_pop_min(SortedList_t *lists, int count,
+					int relaxed, long long *lock_time);
+
+/**
+ * SortedList_bulk_load ... add many elements to lists at once
+ *
+ *	Sorts the elements by key with a merge sort over threads threads,
+ *	then links them in with one merge pass per list, instead of n
+ *	searches from the head. Takes no locks, so no other operation
+ *	may run at the same time.
+ *
+ * @param SortedList_t *lists ... array of count list headers
+ * @param SortedListElement_t *elements ... array of n elements in no list
+ * @param int (*list_of)(const char *key) ... which list a key goes in
+ * @param int threads ... number of sorting threads
+ */
+void SortedList_bulk_load(SortedList_t *lists, int count,
+			  SortedListElement_t *elements, long n,
+			  int (*list_of)(const char*), int threads);
+
 /**
  * variable to enable diagnositc yield calls
  */
@@ -77,3 +148,41 @@ extern int opt_yield;
 #define	INSERT_YIELD	0x01	// yield in insert critical section
 #define	DELETE_YIELD	0x02	// yield in delete critical section
 #define	LOOKUP_YIELD	0x04	// yield in lookup/length critical esction
+
+/**
+ * SortedListOps ... the list operations specialized for one sync mode
+ *	and yield setting (see SortedListTemplate.h), with the mode checks
+ *	resolved at compile time. The SortedList_* functions above call
+ *	through SortedList_ops, so they follow the options only once
+ *	SortedList_select_ops has been called; until then they use the
+ *	unsynchronized copy without yields.
+ */
+struct SortedListOps {
+	void (*insert)(SortedList_t *list, SortedListElement_t *element);
+	int (*delete)(SortedListElement_t *element);
+	SortedListElement_t *(*lookup)(SortedList_t *list, const char *key);
+	int (*length)(SortedList_t *list);
+	int (*remove_key)(SortedList_t *list, const char *key);
+};
+
+/**
+ * SortedList_select_ops ... point SortedList_ops at the copy matching
+ *	the current sync option, opt_yield and opt_deferred. Call again
+ *	after changing any of them.
+ */
+extern struct SortedListOps SortedList_ops;
+void SortedList_select_ops(void);
+
+/**
+ * opt_deferred ... when set before SortedList_select_ops, delete only
+ *	marks the element (low bit of its prev pointer) without locking,
+ *	and lookup and length skip marked elements. A maintenance thread
+ *	unlinks marked elements in one pass per sublist. Needs a locking
+ *	sync option, since the maintenance thread takes the sublist locks.
+ *
+ * SortedList_start_unlinker ... start the thread over count sublists
+ * SortedList_stop_unlinker ... stop it and unlink what is left
+ */
+extern int opt_deferred;
+void SortedList_start_unlinker(SortedList_t *lists, int count);
+void SortedList_stop_unlinker(void);
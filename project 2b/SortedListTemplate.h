@@ -0,0 +1,274 @@
+/*
+ * NAME: Jonathan Chang
+ * EMAIL: j.a.chang820@gmail.com
+ * ID: 104853981
+ */
+
+/** Body of one specialized set of list operations.
+ *
+ *  SortedList.c includes this file once per sync mode, yield setting
+ *  and prefetch setting, after defining
+ *	SL_SYNC     : SL_UNSYNCED, SL_MUTEX, SL_SPINLOCK or SL_ADAPTIVE
+ *	SL_TAG      : suffix for the generated names (none, m, s, f)
+ *	SL_YIELD    : 0 to compile the sched_yield checks out, 1 to keep them
+ *	SL_PREFETCH : 0 to compile the prefetch runner out, 1 to keep it
+ *  Every mode decision is made by the preprocessor, so the generated
+ *  functions test neither sync_opt nor, with SL_YIELD 0, opt_yield,
+ *  nor, with SL_PREFETCH 0, prefetch_distance.
+ *  The macros are undefined again at the end for the next copy.
+ */
+
+#define SL_PASTE(op, tag, yield, pf) op##_##tag##_##yield##_##pf
+#define SL_EXPAND(op, tag, yield, pf) SL_PASTE(op, tag, yield, pf)
+#define SL_NAME(op) SL_EXPAND(op, SL_TAG, SL_YIELD, SL_PREFETCH)
+
+#if SL_SYNC == SL_MUTEX
+#define SL_ACQUIRE(bin) pthread_mutex_lock(&mutex[bin])
+#define SL_RELEASE(bin) pthread_mutex_unlock(&mutex[bin])
+#elif SL_SYNC == SL_SPINLOCK
+#define SL_ACQUIRE(bin) while (__sync_lock_test_and_set(&spinlock[bin], 1))
+#define SL_RELEASE(bin) __sync_lock_release(&spinlock[bin])
+#elif SL_SYNC == SL_ADAPTIVE
+#define SL_ACQUIRE(bin) AdaptiveLock_lock(&adaptive[bin])
+#define SL_RELEASE(bin) AdaptiveLock_unlock(&adaptive[bin])
+#else
+#define SL_ACQUIRE(bin)
+#define SL_RELEASE(bin)
+#endif
+
+#if SL_YIELD
+#define SL_YIELD_IF(flag) if (opt_yield & (flag)) sched_yield()
+#else
+#define SL_YIELD_IF(flag)
+#endif
+
+#if SL_PREFETCH
+#define SL_PREFETCH_START(it) prefetch_start(it)
+#define SL_PREFETCH_STEP(ahead) prefetch_step(ahead)
+#else
+#define SL_PREFETCH_START(it) NULL
+#define SL_PREFETCH_STEP(ahead) (ahead)
+#endif
+
+
+/*! Same sampling as set_lock(); unsynchronized copies never time. */
+static inline void SL_NAME(lock)(int bin, long long *lock_time) {
+#if SL_SYNC == SL_UNSYNCED
+  (void) bin;
+  *lock_time = 0;
+#else
+  struct PreciseTimer timer;
+  *lock_time = 0;
+  if (++sample_count < sample_period) {
+    SL_ACQUIRE(bin);
+    return;
+  }
+  sample_count = 0;
+  PreciseTimer_start(&timer);
+  SL_ACQUIRE(bin);
+  PreciseTimer_end(&timer);
+  *lock_time = timer.diff * sample_period;
+  if (trace_enabled && timer.diff >= trace_threshold)
+    ChromeTrace_span("lock wait", &timer, bin);
+#endif
+}
+
+
+static void SL_NAME(insert)(SortedList_t *list,
+			    SortedListElement_t *element) {
+  struct ListInfo *sList = (struct ListInfo*) list;
+  SortedListElement_t *it = (SortedListElement_t*) sList->list_obj;
+  SortedListElement_t *ahead;
+  int limiter = 0;
+  int bin = sList->bin;
+
+  SL_NAME(lock)(bin, &(sList->timer));
+
+  ahead = SL_PREFETCH_START(it);
+  while (it->next != NULL && strcmp(it->next->key, element->key) < 0) {
+    if (limiter >= list_limit) break; /* prevent infinite loops */
+    it = it->next;
+    ahead = SL_PREFETCH_STEP(ahead);
+    limiter++;
+  }
+
+  SL_YIELD_IF(INSERT_YIELD);
+
+  if (limiter <= list_limit) {
+    if (it->next == NULL || limiter == list_limit) { /* end of list */
+      element->next = NULL;
+    }
+    else {
+      it->next->prev = element;
+      element->next = it->next;
+    }
+    element->prev = it;
+    it->next = element;
+  }
+
+  SL_RELEASE(bin);
+}
+
+
+static int SL_NAME(delete)(SortedListElement_t *element) {
+  struct ListInfo *sList = (struct ListInfo*) element;
+  SortedListElement_t *el = (SortedListElement_t*) sList->list_obj;
+  int bin = sList->bin;
+  SL_NAME(lock)(bin, &(sList->timer));
+
+  if (el->prev == NULL ||          /* head cannot be deleted or */
+      el->prev->next != el ||      /* list is corrupted */
+      (el->next != NULL && el->next->prev != el)) {
+    SL_RELEASE(bin);
+    return 1;
+  }
+
+  SL_YIELD_IF(DELETE_YIELD);
+
+  if (el->next == NULL) {          /* last element in list       */
+    el->prev->next = NULL;
+  }
+  else {
+    el->prev->next = el->next;
+    el->next->prev = el->prev;
+  }
+
+  SL_RELEASE(bin);
+
+  el->next = NULL;
+  el->prev = NULL;
+  return 0;
+}
+
+
+static SortedListElement_t *SL_NAME(lookup)(SortedList_t *list,
+					    const char *key) {
+  struct ListInfo *sList = (struct ListInfo*) list;
+  SortedListElement_t *it = (SortedListElement_t*) sList->list_obj;
+  SortedListElement_t *ahead;
+  int bin = sList->bin;
+  SortedListElement_t *result;
+  int limiter = 0;
+
+  SL_NAME(lock)(bin, &(sList->timer));
+
+  ahead = SL_PREFETCH_START(it);
+  while (it->next != NULL && strcmp(it->next->key, key) != 0) {
+    if (limiter >= list_limit) break; /* prevent infinite loops */
+    it = it->next;
+    ahead = SL_PREFETCH_STEP(ahead);
+    limiter++;
+  }
+
+  SL_YIELD_IF(LOOKUP_YIELD);
+
+  if (limiter <= list_limit) {
+    if (it->next == NULL || limiter == list_limit)
+      result = NULL;
+    else result = it->next;
+  }
+  else result = NULL;
+
+  SL_RELEASE(bin);
+
+  return result;
+}
+
+
+static int SL_NAME(remove_key)(SortedList_t *list, const char *key) {
+  struct ListInfo *sList = (struct ListInfo*) list;
+  SortedListElement_t *it = (SortedListElement_t*) sList->list_obj;
+  SortedListElement_t *ahead;
+  SortedListElement_t *el;
+  int bin = sList->bin;
+  int limiter = 0;
+
+  SL_NAME(lock)(bin, &(sList->timer));
+
+  ahead = SL_PREFETCH_START(it);
+  while (it->next != NULL && strcmp(it->next->key, key) != 0) {
+    if (limiter >= list_limit) break; /* prevent infinite loops */
+    it = it->next;
+    ahead = SL_PREFETCH_STEP(ahead);
+    limiter++;
+  }
+
+  SL_YIELD_IF(LOOKUP_YIELD);
+
+  el = it->next;
+  if (el == NULL || limiter >= list_limit) {  /* no such key */
+    SL_RELEASE(bin);
+    return -1;
+  }
+  if (el->prev != it ||                       /* list is corrupted */
+      (el->next != NULL && el->next->prev != el)) {
+    SL_RELEASE(bin);
+    return 1;
+  }
+
+  SL_YIELD_IF(DELETE_YIELD);
+
+  it->next = el->next;
+  if (el->next != NULL)
+    el->next->prev = it;
+
+  SL_RELEASE(bin);
+
+  el->next = NULL;
+  el->prev = NULL;
+  return 0;
+}
+
+
+static int SL_NAME(length)(SortedList_t *list) {
+  struct ListInfo *sList = (struct ListInfo*) list;
+  SortedListElement_t *it = (SortedListElement_t*) sList->list_obj;
+  SortedListElement_t *ahead;
+  int bin = sList->bin;
+  int limiter = 0;
+
+  SL_YIELD_IF(LOOKUP_YIELD);
+
+  SL_NAME(lock)(bin, &(sList->timer));
+
+  ahead = SL_PREFETCH_START(it);
+  while (it->next != NULL) {
+    if (it->next->prev != it) { /* list corrupted */
+      limiter = -1;
+      break;
+    }
+    if (limiter >= list_limit ) { /* prevent infinite loop */
+      limiter = -1;
+      break;
+    }
+    limiter++;
+    it = it->next;
+    ahead = SL_PREFETCH_STEP(ahead);
+  }
+
+  SL_RELEASE(bin);
+
+  return limiter;
+}
+
+
+static const struct SortedListOps SL_NAME(ops) = {
+  SL_NAME(insert),
+  SL_NAME(delete),
+  SL_NAME(lookup),
+  SL_NAME(length),
+  SL_NAME(remove_key)
+};
+
+#undef SL_PASTE
+#undef SL_EXPAND
+#undef SL_NAME
+#undef SL_ACQUIRE
+#undef SL_RELEASE
+#undef SL_YIELD_IF
+#undef SL_PREFETCH_START
+#undef SL_PREFETCH_STEP
+#undef SL_SYNC
+#undef SL_TAG
+#undef SL_YIELD
+#undef SL_PREFETCH
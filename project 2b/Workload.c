@@ -0,0 +1,180 @@
+/*
+ * NAME: Jonathan Chang
+ * EMAIL: j.a.chang820@gmail.com
+ * ID: 104853981
+ */ 
+
+#include <errno.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include "Workload.h"
+
+
+static void write_or_die(FILE *file, const void *data, size_t size,
+			 const char *file_name) {
+  if (size > 0 && fwrite(data, size, 1, file) != 1) {
+    fprintf(stderr, "Workload file %s could not be written.\r\n%s\r\n",
+	    file_name, strerror(errno));
+    exit(2);
+  }
+}
+
+
+static void read_or_die(FILE *file, void *data, size_t size,
+			const char *file_name) {
+  if (size > 0 && fread(data, size, 1, file) != 1) {
+    fprintf(stderr, "Workload file %s is truncated.\r\n", file_name);
+    exit(2);
+  }
+}
+
+
+/* zeroed, so Workload_free() can clean up a half-read workload */
+static void *alloc_or_die(size_t size) {
+  void *block = calloc(1, size);
+  if (block == NULL && size > 0) {
+    fprintf(stderr, "Insufficient memory for the workload.\r\n");
+    exit(2);
+  }
+  return block;
+}
+
+
+void Workload_write(const char *file_name, const struct Workload *workload) {
+  struct WorkloadHeader header;
+  FILE *file;
+  uint64_t count;
+  long n;
+  int t;
+
+  file = fopen(file_name, "wb");
+  if (file == NULL) {
+    fprintf(stderr, "Workload file %s could not be opened.\r\n%s\r\n",
+	    file_name, strerror(errno));
+    exit(2);
+  }
+
+  memcpy(header.magic, WORKLOAD_MAGIC, sizeof(header.magic));
+  header.version = WORKLOAD_VERSION;
+  header.threads = workload->threads;
+  header.key_length = workload->key_length;
+  header.elements = workload->elements;
+  write_or_die(file, &header, sizeof(header), file_name);
+
+  for (n = 0; n < workload->elements; n++)
+    write_or_die(file, workload->keys[n], workload->key_length, file_name);
+
+  for (t = 0; t < workload->threads; t++) {
+    count = workload->count[t];
+    write_or_die(file, &count, sizeof(count), file_name);
+    write_or_die(file, workload->ops[t],
+		 count * sizeof(struct WorkloadOp), file_name);
+  }
+
+  if (fclose(file) != 0) {
+    fprintf(stderr, "Workload file %s could not be written.\r\n%s\r\n",
+	    file_name, strerror(errno));
+    exit(2);
+  }
+}
+
+
+/*! Loads and checks a workload. Every thread must pass the same number
+ *  of barriers, or replaying it would leave some threads waiting. */
+void Workload_read(const char *file_name, struct Workload *workload) {
+  struct WorkloadHeader header;
+  struct WorkloadOp *op;
+  FILE *file;
+  uint64_t count;
+  long barriers, first_barriers = 0;
+  long n;
+  int t;
+
+  file = fopen(file_name, "rb");
+  if (file == NULL) {
+    fprintf(stderr, "Workload file %s could not be opened.\r\n%s\r\n",
+	    file_name, strerror(errno));
+    exit(2);
+  }
+
+  read_or_die(file, &header, sizeof(header), file_name);
+  if (memcmp(header.magic, WORKLOAD_MAGIC, sizeof(header.magic)) != 0 ||
+      header.version != WORKLOAD_VERSION) {
+    fprintf(stderr, "%s is not a version %d workload file.\r\n",
+	    file_name, WORKLOAD_VERSION);
+    exit(2);
+  }
+  if (header.threads == 0 || header.key_length == 0 ||
+      header.elements == 0 || header.elements > UINT32_MAX) {
+    fprintf(stderr, "Workload file %s has an invalid header.\r\n", file_name);
+    exit(2);
+  }
+  workload->threads = header.threads;
+  workload->key_length = header.key_length;
+  workload->elements = header.elements;
+  workload->operations = 0;
+
+  workload->keys = alloc_or_die(workload->elements * sizeof(char*));
+  for (n = 0; n < workload->elements; n++) {
+    workload->keys[n] = alloc_or_die(workload->key_length + 1);
+    read_or_die(file, workload->keys[n], workload->key_length, file_name);
+    workload->keys[n][workload->key_length] = '\0';
+  }
+
+  workload->count = alloc_or_die(workload->threads * sizeof(long));
+  workload->ops = alloc_or_die(workload->threads *
+			       sizeof(struct WorkloadOp*));
+  for (t = 0; t < workload->threads; t++) {
+    read_or_die(file, &count, sizeof(count), file_name);
+    workload->count[t] = count;
+    workload->ops[t] = alloc_or_die(count * sizeof(struct WorkloadOp));
+    read_or_die(file, workload->ops[t], count * sizeof(struct WorkloadOp),
+		file_name);
+
+    barriers = 0;
+    for (n = 0; n < workload->count[t]; n++) {
+      op = &workload->ops[t][n];
+      if (op->op > WORKLOAD_BARRIER || op->element >= workload->elements) {
+	fprintf(stderr, "Workload file %s has an invalid operation.\r\n",
+		file_name);
+	exit(2);
+      }
+      if (op->op == WORKLOAD_BARRIER) barriers++;
+      else if (op->op == WORKLOAD_DELETE) workload->operations += 2;
+      else if (op->op != WORKLOAD_LENGTH) workload->operations++;
+    }
+    if (t == 0) first_barriers = barriers;
+    else if (barriers != first_barriers) {
+      fprintf(stderr, "Threads in workload file %s do not pass the same "
+	      "number of barriers.\r\n", file_name);
+      exit(2);
+    }
+  }
+  fclose(file);
+  if (workload->operations == 0) {
+    fprintf(stderr, "Workload file %s has no list operations.\r\n",
+	    file_name);
+    exit(2);
+  }
+}
+
+
+void Workload_free(struct Workload *workload) {
+  long n;
+  int t;
+  if (workload->keys != NULL) {
+    for (n = 0; n < workload->elements; n++)
+      free(workload->keys[n]);
+    free(workload->keys);
+    workload->keys = NULL;
+  }
+  if (workload->ops != NULL) {
+    for (t = 0; t < workload->threads; t++)
+      free(workload->ops[t]);
+    free(workload->ops);
+    workload->ops = NULL;
+  }
+  free(workload->count);
+  workload->count = NULL;
+}
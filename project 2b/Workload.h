@@ -0,0 +1,58 @@
+/*
+ * NAME: Jonathan Chang
+ * EMAIL: j.a.chang820@gmail.com
+ * ID: 104853981
+ */ 
+
+/** Recorded list workloads for --record and --replay.
+ *
+ *  A workload is everything a run depends on apart from the sync mode
+ *  and backend: the keys, and for every thread the operations it
+ *  performs in order. Replaying one file against several modes runs
+ *  each of them on identical input.
+ *
+ *  File layout, integers in host byte order:
+ *	struct WorkloadHeader
+ *	elements * key_length key bytes, no terminators
+ *	per thread: uint64_t op count, then that many WorkloadOps
+ */ 
+
+#include <stdint.h>
+
+#define WORKLOAD_MAGIC "L2BW"
+#define WORKLOAD_VERSION 1
+
+enum workload_op {
+  WORKLOAD_INSERT,   /* insert element                             */
+  WORKLOAD_LOOKUP,   /* look up element's key, a miss is fine       */
+  WORKLOAD_DELETE,   /* look up element's key and delete the match  */
+  WORKLOAD_LENGTH,   /* count the sublists not yet counted          */
+  WORKLOAD_BARRIER   /* wait for every thread to reach its barrier  */
+};
+
+struct WorkloadHeader {
+  char magic[4];
+  uint32_t version;
+  uint32_t threads;
+  uint32_t key_length;
+  uint64_t elements;
+};
+
+struct WorkloadOp {
+  uint32_t op;
+  uint32_t element;  /* index into the key table */
+};
+
+struct Workload {
+  int threads;
+  long elements;
+  int key_length;
+  char **keys;               /* NUL-terminated copies, one per element */
+  long *count;               /* ops per thread */
+  struct WorkloadOp **ops;   /* ops[t][0 .. count[t]-1] */
+  long operations;           /* list operations, a delete counting two */
+};
+
+void Workload_write(const char *file_name, const struct Workload *workload);
+void Workload_read(const char *file_name, struct Workload *workload);
+void Workload_free(struct Workload *workload);
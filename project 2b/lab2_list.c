@@ -20,15 +20,47 @@
 #include "SortedList.h"
 #include "PreciseTimer.h"
 #include "ListInfo.h"
+#include "PerfCounters.h"
+#include "ChromeTrace.h"
+#include "ListBackend.h"
+#include "CompactList.h"
+#include "BPlusTree.h"
+#include "ArtTree.h"
+#include "Delegation.h"
+#include "Workload.h"
+#include "Snapshot.h"
 
 /* program parameter values */
 int num_threads;
 long num_iterations;
-long num_elements;
+extern long num_elements;
+extern long sample_period;
+extern int prefetch_distance;
 int num_lists = 1;
 long long *wait_for_time;
 char str_sync[5];
 char str_yield[5];
+int opt_perf = 0;
+struct PerfCounters perf_total;
+char *trace_file = NULL;
+const struct ListBackend *list_backend;
+int opt_delegate = 0;
+char *record_file = NULL;
+char *replay_file = NULL;
+struct Workload workload;
+int verify_threads = 1;
+int batch_size = 1;
+enum pop_modes {POP_NONE, POP_STRICT, POP_RELAXED} opt_pop = POP_NONE;
+long *element_rank;
+long pops_done = 0;
+long long rank_error_total = 0;
+char *save_file = NULL;
+char *load_file = NULL;
+int snapshot_saved = 0;
+long long snapshot_time = 0;  /* ns spent in --save, left out of the run */
+long preload_count = 0;
+SortedListElement_t *preload_elements;
+long loaded_count = 0;  /* elements linked in from a --load snapshot */
 
 const int KEY_BITS = 128;
 const int VISIBLE_ASCII_CHARS = 95;
@@ -43,23 +75,67 @@ int *threads_finished_inserting;
 int *threads_finished_deleting;
 long long *list_count_total;
 int *list_count;
+long barriers_reached = 0;
+
+struct VerifyTask {
+  int id;
+  long count;   /* elements found in the lists */
+  int corrupt;
+};
 
 
 /* function declarations */
 int get_bin(const char*);
 void set_up_ListInfo(struct ListInfo*, void*, int);
 static void* list_operations(void*);
+static long long lookup_delete_batch(long, int);
+static long long delete_key(int, const char*);
+static void* replay_operations(void*);
+static void* pop_operations(void*);
 void process_args(int, char**);
 void initialize_list();
 void randomize_list_elements(int);
+void load_workload_elements(void);
+void record_workload(void);
+void rank_elements(void);
+void preload_lists(void);
 void create_threads(pthread_t*);
 void join_threads(pthread_t*);
 void check_correct_list_length(int, long long*);
+static void verify_element(struct VerifyTask*, SortedListElement_t*);
+static void* verify_elements(void*);
+static void* verify_bins(void*);
+void verify_lists(void);
 int delete_list(void);
 void append_csv(long long);
 char* compute_test_name(void);
 void sighandler(int);
 void cleanup(void);
+static void sorted_insert(int, long, long long*);
+static long sorted_lookup(int, const char*, long long*);
+static int sorted_delete(int, long, long long*);
+static int sorted_length(int, long long*);
+static int sorted_remove(int, const char*, long long*);
+
+/* the doubly-linked SortedList through the ops chosen for this run */
+static const struct ListBackend sorted_backend = {
+  "list",
+  NULL,
+  sorted_insert,
+  sorted_lookup,
+  sorted_delete,
+  sorted_length,
+  NULL,
+  sorted_remove
+};
+
+static const struct ListBackend *backends[] = {
+  &sorted_backend,
+  &CompactList_backend,
+  &BPlusTree_backend,
+  &ArtTree_backend,
+  NULL
+};
 
 
 int main(int argc, char *argv[]) {
@@ -79,23 +155,53 @@ int main(int argc, char *argv[]) {
     exit(2);
   }
 
-  long long *dummy;
+  long trace_capacity;
+  int t;
 
   process_args(argc, argv);
   threads = calloc(num_threads, sizeof(pthread_t));
   initialize_list();
-  randomize_list_elements(time(NULL));
+  if (replay_file != NULL)
+    load_workload_elements();
+  else
+    randomize_list_elements(time(NULL));
+  if (record_file != NULL)
+    record_workload();
+  if (opt_pop != POP_NONE)
+    rank_elements();
+  if (load_file != NULL)
+    loaded_count = Snapshot_load(load_file, list, num_lists, get_bin);
+  if (preload_count > 0)
+    preload_lists();
+  /* traversals must allow for the nodes that were already there */
+  limit_iterations(num_elements + loaded_count + preload_count);
   initialize_sync(num_lists);
+  SortedList_select_ops();
+  if (list_backend->init != NULL) list_backend->init();
+  if (opt_deferred) SortedList_start_unlinker(list, num_lists);
+  if (trace_file != NULL) {
+    trace_capacity = 3 * num_iterations;
+    if (replay_file != NULL)  /* two lock waits and a phase per op at most */
+      for (t = 0; t < num_threads; t++)
+	if (3 * workload.count[t] > trace_capacity)
+	  trace_capacity = 3 * workload.count[t];
+    ChromeTrace_init(num_threads, trace_capacity + num_lists + 8);
+  }
   PreciseTimer_start(&timer);
   create_threads(threads);
   join_threads(threads);
-  memset(list_count, 0, num_lists);
-  check_correct_list_length(1, dummy);
+  if (opt_deferred) SortedList_stop_unlinker();
+  verify_lists();
   PreciseTimer_end(&timer);
+  if (trace_file != NULL) {
+    ChromeTrace_write(trace_file);
+    ChromeTrace_destroy();
+  }
+  if (list_backend->destroy != NULL) list_backend->destroy();
   destroy_sync();
   pthread_mutex_destroy(&mut);
   list_deleted = delete_list();
-  append_csv(timer.diff);
+  append_csv(timer.diff - snapshot_time);
   free(threads);
 
   exit(0);
@@ -128,66 +234,350 @@ void set_up_ListInfo(struct ListInfo *sList, void* list_obj, int bin) {
 }
 
 
+static void sorted_insert(int bin, long n, long long *lock_time) {
+  struct ListInfo sList;
+  set_up_ListInfo(&sList, (void*) &list[bin], bin);
+  SortedList_ops.insert((SortedList_t*) &sList, list_elements + n);
+  *lock_time = sList.timer;
+}
+
+
+static long sorted_lookup(int bin, const char *key, long long *lock_time) {
+  struct ListInfo sList;
+  SortedListElement_t *matching;
+  set_up_ListInfo(&sList, (void*) &list[bin], bin);
+  matching = SortedList_ops.lookup((SortedList_t*) &sList, key);
+  *lock_time = sList.timer;
+  return (matching == NULL) ? -1 : matching - list_elements;
+}
+
+
+static int sorted_delete(int bin, long n, long long *lock_time) {
+  struct ListInfo sList;
+  int result;
+  set_up_ListInfo(&sList, (void*) (list_elements + n), bin);
+  result = SortedList_ops.delete((SortedListElement_t*) &sList);
+  *lock_time = sList.timer;
+  return result;
+}
+
+
+static int sorted_length(int bin, long long *lock_time) {
+  struct ListInfo sList;
+  int count;
+  set_up_ListInfo(&sList, (void*) &list[bin], bin);
+  count = SortedList_ops.length((SortedList_t*) &sList);
+  *lock_time = sList.timer;
+  return count;
+}
+
+
+static int sorted_remove(int bin, const char *key, long long *lock_time) {
+  struct ListInfo sList;
+  int result;
+  set_up_ListInfo(&sList, (void*) &list[bin], bin);
+  result = SortedList_ops.remove_key((SortedList_t*) &sList, key);
+  *lock_time = sList.timer;
+  return result;
+}
+
+
 /*! Function to be used by pthread */
 static void* list_operations(void* thread_id) {
   int id = *((int*) thread_id);
   long start_index = id * num_iterations;
   long end_index = ((id+1) * num_iterations) - 1;
   long long wait_per_thread_time = 0;
-  SortedListElement_t *matching;
+  long long lock_time;
   long n;
   int bin;
-  struct ListInfo sList;
+  int last;
+  struct PerfCounters perf;
+  struct PreciseTimer phase, save;
+  if (opt_perf) PerfCounters_start(&perf);
+  if (trace_enabled) ChromeTrace_attach(id);
+
   /* insert elements to list */
+  if (trace_enabled) PreciseTimer_start(&phase);
   for (n = start_index; n <= end_index; n++) {
     bin = get_bin(list_elements[n].key);
-    set_up_ListInfo(&sList, (void*) &list[bin], bin);
-    SortedList_insert((SortedList_t*) &sList, 
-		      (SortedListElement_t*)(list_elements + n));
-    wait_per_thread_time += sList.timer;
+    list_backend->insert(bin, n, &lock_time);
+    wait_per_thread_time += lock_time;
+  }
+  if (trace_enabled) {
+    PreciseTimer_end(&phase);
+    ChromeTrace_span("insert", &phase, -1);
+    PreciseTimer_start(&phase);
   }
   /* make sure all threads have finished inserting */
   pthread_mutex_lock(&mut);
-  (*threads_finished_inserting)++;
+  last = (++(*threads_finished_inserting) == num_threads);
   pthread_mutex_unlock(&mut);
+  if (last && save_file != NULL) {  /* the lists are full and quiet */
+    PreciseTimer_start(&save);
+    Snapshot_save(save_file, list, num_lists);
+    PreciseTimer_end(&save);
+    snapshot_time = save.diff;
+    __atomic_store_n(&snapshot_saved, 1, __ATOMIC_RELEASE);
+  }
   while (*threads_finished_inserting != num_threads)
     ;
+  while (save_file != NULL &&
+	 !__atomic_load_n(&snapshot_saved, __ATOMIC_ACQUIRE))
+    ;
+  if (trace_enabled) {
+    PreciseTimer_end(&phase);
+    ChromeTrace_span("insert barrier", &phase, -1);
+    PreciseTimer_start(&phase);
+  }
   
   /* check list length */
   long long wait_timer;
   check_correct_list_length(0, &wait_timer);
   wait_per_thread_time += wait_timer;
+  if (trace_enabled) {
+    PreciseTimer_end(&phase);
+    ChromeTrace_span("length", &phase, -1);
+    PreciseTimer_start(&phase);
+  }
 
   /* delete elements from list */
-  for (n = start_index; n <= end_index; n++) {
-    bin = get_bin(list_elements[n].key);
-    set_up_ListInfo(&sList, (void*) &list[bin], bin);
-    matching = SortedList_lookup((SortedList_t*) &sList, 
-			 ((SortedListElement_t*)(list_elements + n))->key);
-    wait_per_thread_time += sList.timer;
+  if (batch_size > 1) {
+    for (n = start_index; n <= end_index; n += batch_size)
+      wait_per_thread_time +=
+	lookup_delete_batch(n, (end_index - n + 1 < batch_size) ?
+			    end_index - n + 1 : batch_size);
+  }
+  else {
+    for (n = start_index; n <= end_index; n++)
+      wait_per_thread_time += delete_key(get_bin(list_elements[n].key),
+					 list_elements[n].key);
+  }
+  if (trace_enabled) {
+    PreciseTimer_end(&phase);
+    ChromeTrace_span("lookup/delete", &phase, -1);
+    PreciseTimer_start(&phase);
+  }
 
-    if (matching == NULL) {
+  /* make sure all threads have finished deleting */
+  pthread_mutex_lock(&mut);
+  (*threads_finished_deleting)++;
+  pthread_mutex_unlock(&mut);
+  while (*threads_finished_deleting != num_threads)
+    ;
+  if (trace_enabled) {
+    PreciseTimer_end(&phase);
+    ChromeTrace_span("delete barrier", &phase, -1);
+  }
+
+  if (opt_perf) PerfCounters_stop(&perf);
+
+  pthread_mutex_lock(&mut);
+  long long sum = *wait_for_time + wait_per_thread_time;;
+  *wait_for_time = sum;
+  if (opt_perf) PerfCounters_add(&perf_total, &perf);
+  pthread_mutex_unlock(&mut);
+
+  return NULL;
+}
+
+
+/*! Deletes the element holding key, in one call when the backend can
+ *  remove by key and by lookup then delete otherwise. Returns the lock
+ *  wait. */
+static long long delete_key(int bin, const char *key) {
+  long long wait_time, lock_time;
+  long matching;
+  int result;
+
+  if (list_backend->remove != NULL) {
+    result = list_backend->remove(bin, key, &wait_time);
+  }
+  else {
+    matching = list_backend->lookup(bin, key, &wait_time);
+    result = -1;
+    if (matching != -1) {
+      result = list_backend->delete(bin, matching, &lock_time);
+      wait_time += lock_time;
+    }
+  }
+
+  if (result == -1) {
+    fprintf(stderr, "No matching element found during list lookup.\r\n");
+    exit(2);
+  }
+  if (result == 1) {
+    fprintf(stderr, "List was corrupted during 'delete' operation.\r\n");
+    exit(2);
+  }
+  return wait_time;
+}
+
+
+/*! Looks up count elements from n on in one interleaved batch, then
+ *  deletes the matches one at a time. Returns the lock wait. */
+static long long lookup_delete_batch(long n, int count) {
+  struct ListInfo infos[SORTEDLIST_MAX_BATCH];
+  SortedList_t *lists[SORTEDLIST_MAX_BATCH];
+  const char *keys[SORTEDLIST_MAX_BATCH];
+  SortedListElement_t *results[SORTEDLIST_MAX_BATCH];
+  long long wait_time, lock_time;
+  int bin, k;
+
+  for (k = 0; k < count; k++) {
+    keys[k] = list_elements[n + k].key;
+    bin = get_bin(keys[k]);
+    set_up_ListInfo(&infos[k], (void*) &list[bin], bin);
+    lists[k] = (SortedList_t*) &infos[k];
+  }
+  SortedList_lookup_batch(lists, keys, results, count);
+  wait_time = infos[0].timer;
+
+  for (k = 0; k < count; k++) {
+    if (results[k] == NULL) {
       fprintf(stderr, "No matching element found during list lookup.\r\n");
       exit(2);
     }
-    set_up_ListInfo(&sList, (void*) matching, bin);
-    if (SortedList_delete((SortedListElement_t*) &sList) == 1) {
+    if (sorted_delete(infos[k].bin, results[k] - list_elements,
+		      &lock_time) == 1) {
       fprintf(stderr, "List was corrupted during 'delete' operation.\r\n");
       exit(2);
     }
-    wait_per_thread_time += sList.timer;
+    wait_time += lock_time;
   }
+  return wait_time;
+}
 
-  /* make sure all threads have finished deleting */
+
+/*! Function to be used by pthread with --pop: every thread inserts its
+ *  elements, spread over the sublists by index instead of key, then
+ *  pops as many. A perfect queue would give the k-th pop overall the
+ *  element of rank k, so the distance between the two is the pop's
+ *  rank error. */
+static void* pop_operations(void* thread_id) {
+  int id = *((int*) thread_id);
+  long start_index = id * num_iterations;
+  long end_index = ((id+1) * num_iterations) - 1;
+  long long wait_per_thread_time = 0;
+  long long rank_error = 0;
+  long long lock_time;
+  SortedListElement_t *popped;
+  long position, rank;
+  long n;
+  struct PerfCounters perf;
+  struct PreciseTimer phase;
+  if (opt_perf) PerfCounters_start(&perf);
+  if (trace_enabled) {
+    ChromeTrace_attach(id);
+    PreciseTimer_start(&phase);
+  }
+
+  for (n = start_index; n <= end_index; n++) {
+    sorted_insert(n % num_lists, n, &lock_time);
+    wait_per_thread_time += lock_time;
+  }
   pthread_mutex_lock(&mut);
-  (*threads_finished_deleting)++;
+  (*threads_finished_inserting)++;
   pthread_mutex_unlock(&mut);
-  while (*threads_finished_deleting != num_threads)
+  while (*threads_finished_inserting != num_threads)
     ;
+  if (trace_enabled) {
+    PreciseTimer_end(&phase);
+    ChromeTrace_span("insert", &phase, -1);
+    PreciseTimer_start(&phase);
+  }
+
+  for (n = start_index; n <= end_index; n++) {
+    popped = SortedList_pop_min(list, num_lists, opt_pop == POP_RELAXED,
+				&lock_time);
+    wait_per_thread_time += lock_time;
+    if (popped == NULL) {
+      fprintf(stderr, "Queue was empty during 'pop_min' operation.\r\n");
+      exit(2);
+    }
+    position = __atomic_fetch_add(&pops_done, 1, __ATOMIC_RELAXED);
+    rank = element_rank[popped - list_elements];
+    rank_error += (rank > position) ? rank - position : position - rank;
+  }
+  if (trace_enabled) {
+    PreciseTimer_end(&phase);
+    ChromeTrace_span("pop_min", &phase, -1);
+  }
+
+  if (opt_perf) PerfCounters_stop(&perf);
 
   pthread_mutex_lock(&mut);
-  long long sum = *wait_for_time + wait_per_thread_time;;
-  *wait_for_time = sum;
+  *wait_for_time += wait_per_thread_time;
+  rank_error_total += rank_error;
+  if (opt_perf) PerfCounters_add(&perf_total, &perf);
+  pthread_mutex_unlock(&mut);
+
+  return NULL;
+}
+
+
+static const char *replay_phase[] = {
+  "insert", "lookup", "lookup/delete", "length", "barrier"
+};
+
+
+/*! Function to be used by pthread when replaying a workload file. Each
+ *  run of equal operations is traced as one phase. */
+static void* replay_operations(void* thread_id) {
+  int id = *((int*) thread_id);
+  struct WorkloadOp *op = workload.ops[id];
+  struct WorkloadOp *end = op + workload.count[id];
+  long long wait_per_thread_time = 0;
+  long long lock_time;
+  long barriers = 0;
+  const char *key;
+  struct PerfCounters perf;
+  struct PreciseTimer phase;
+  if (opt_perf) PerfCounters_start(&perf);
+  if (trace_enabled) {
+    ChromeTrace_attach(id);
+    PreciseTimer_start(&phase);
+  }
+
+  for (; op < end; op++) {
+    key = list_elements[op->element].key;
+    lock_time = 0;
+    switch (op->op) {
+    case WORKLOAD_INSERT:
+      list_backend->insert(get_bin(key), op->element, &lock_time);
+      break;
+    case WORKLOAD_LOOKUP:
+      list_backend->lookup(get_bin(key), key, &lock_time);
+      break;
+    case WORKLOAD_DELETE:
+      lock_time = delete_key(get_bin(key), key);
+      break;
+    case WORKLOAD_LENGTH:
+      check_correct_list_length(0, &lock_time);
+      break;
+    case WORKLOAD_BARRIER:
+      barriers++;
+      pthread_mutex_lock(&mut);
+      barriers_reached++;
+      pthread_mutex_unlock(&mut);
+      while (__atomic_load_n(&barriers_reached, __ATOMIC_ACQUIRE) <
+	     barriers * num_threads)
+	;
+      break;
+    }
+    wait_per_thread_time += lock_time;
+    if (trace_enabled && (op + 1 == end || op[1].op != op->op)) {
+      PreciseTimer_end(&phase);
+      ChromeTrace_span(replay_phase[op->op], &phase, -1);
+      PreciseTimer_start(&phase);
+    }
+  }
+
+  if (opt_perf) PerfCounters_stop(&perf);
+
+  pthread_mutex_lock(&mut);
+  *wait_for_time += wait_per_thread_time;
+  if (opt_perf) PerfCounters_add(&perf_total, &perf);
   pthread_mutex_unlock(&mut);
 
   return NULL;
@@ -196,20 +586,41 @@ static void* list_operations(void* thread_id) {
 
 void process_args(int argc, char* argv[]) {
   int opt, longindex;
+  int use_tsc = 0;
+  int n;
 
-  char correct_usage[325] = 
+  char correct_usage[1378] = 
     "Correct usage:\r\n"
-    "/lab2_add --threads=# --iterations=# --sync=m|s --yield=[idl]\r\n"
+    "/lab2_add --threads=# --iterations=# --sync=m|s|f --yield=[idl]\r\n"
     "--thread     : number of threads used to add\r\n"
     "--iterations : number of iterations add will be run\r\n"
-    "--sync       : synchronize with mutex or spinlock\r\n"
+    "--sync       : synchronize with mutex, spinlock, futex or delegation\r\n"
     "--yield      : whether to yield and increase failure rate\r\n"
-    "--lists      : number of sub lists\r\n\0";
+    "--lists      : number of sub lists\r\n"
+    "--perf       : append per-operation hardware counters\r\n"
+    "--trace      : write a Chrome trace of thread phases to file\r\n"
+    "--trace-threshold : shortest lock wait to trace (ns)\r\n"
+    "--timer      : time lock waits with tsc or clock (default)\r\n"
+    "--sample     : time only 1 in # lock acquisitions\r\n"
+    "--prefetch   : prefetch nodes # links ahead while traversing\r\n"
+    "--backend    : list (default), compact (32-bit index links),\r\n"
+    "               bplus (B+-tree) or art (adaptive radix tree)\r\n"
+    "--record     : write the keys and operations of this run to file\r\n"
+    "--replay     : run the keys and operations in file instead\r\n"
+    "--verify-threads : threads for the final integrity check\r\n"
+    "--batch      : interleave # lookups at a time (list backend)\r\n"
+    "--unlink     : eager (default), or deferred to a background thread\r\n"
+    "--pop        : insert, then pop_min everything, strict or relaxed\r\n"
+    "--save       : snapshot the lists to file once all are inserted\r\n"
+    "--load       : start from the lists in a snapshot file\r\n"
+    "--preload    : bulk load # more random elements before timing\r\n\0";
   
-  char sync_usage[101] =
+  char sync_usage[176] =
     "Sync options are:\r\n"
     "m            : mutex\r\n"
-    "s            : spin-lock\r\n\0";
+    "s            : spin-lock\r\n"
+    "f            : adaptive spin-then-park futex lock\r\n"
+    "d            : delegate each sublist to an owner thread\r\n\0";
 
   char yield_usage[96] =
     "Yield options are: [idl]\r\n"
@@ -224,6 +635,7 @@ void process_args(int argc, char* argv[]) {
   opt_yield = 0;
   strcpy(str_sync, "none\0");
   strcpy(str_yield, "none\0");
+  list_backend = &sorted_backend;
 
   while(1) {
     longindex =0;
@@ -233,6 +645,22 @@ void process_args(int argc, char* argv[]) {
       {"yield"      , required_argument, 0, 'y' },
       {"sync"       , required_argument, 0, 's' },
       {"lists"      , required_argument, 0, 'l' },
+      {"perf"       , no_argument      , 0, 'p' },
+      {"trace"      , required_argument, 0, 'T' },
+      {"trace-threshold", required_argument, 0, 'w' },
+      {"timer"      , required_argument, 0, 'k' },
+      {"sample"     , required_argument, 0, 'S' },
+      {"prefetch"   , required_argument, 0, 'P' },
+      {"backend"    , required_argument, 0, 'b' },
+      {"record"     , required_argument, 0, 'r' },
+      {"replay"     , required_argument, 0, 'R' },
+      {"verify-threads", required_argument, 0, 'v' },
+      {"batch"      , required_argument, 0, 'B' },
+      {"unlink"     , required_argument, 0, 'u' },
+      {"pop"        , required_argument, 0, 'o' },
+      {"save"       , required_argument, 0, 'a' },
+      {"load"       , required_argument, 0, 'L' },
+      {"preload"    , required_argument, 0, 'D' },
       {0            , 0                , 0,  0  }
     };
     opt = getopt_long(argc, argv, "", longopt, &longindex);
@@ -255,7 +683,9 @@ void process_args(int argc, char* argv[]) {
       strncpy(str_yield, optarg, 5);
       break;
     case 's':
-      if (sync_by(*optarg) == 1) {
+      if (*optarg == 'd')  /* owners run the operations unsynchronized */
+	opt_delegate = 1;
+      else if (sync_by(*optarg) == 1) {
 	fprintf(stderr, sync_usage);
 	exit(1);
       }
@@ -264,6 +694,102 @@ void process_args(int argc, char* argv[]) {
     case 'l':
       num_lists = atoi(optarg);
       break;
+    case 'p':
+      opt_perf = 1;
+      PerfCounters_clear(&perf_total);
+      break;
+    case 'T':
+      trace_file = optarg;
+      break;
+    case 'w':
+      trace_threshold = atoll(optarg);
+      break;
+    case 'k':
+      if (strcmp(optarg, "tsc") == 0)
+	use_tsc = 1;
+      else if (strcmp(optarg, "clock") != 0) {
+	fprintf(stderr, "Timer options are: tsc, clock\r\n");
+	exit(1);
+      }
+      break;
+    case 'S':
+      sample_period = atol(optarg);
+      if (sample_period < 1) {
+	fprintf(stderr, "Sample period must be at least 1.\r\n");
+	exit(1);
+      }
+      break;
+    case 'b':
+      for (n = 0; backends[n] != NULL; n++)
+	if (strcmp(backends[n]->name, optarg) == 0) break;
+      if (backends[n] == NULL) {
+	fprintf(stderr, "Backend options are:");
+	for (n = 0; backends[n] != NULL; n++)
+	  fprintf(stderr, " %s", backends[n]->name);
+	fprintf(stderr, "\r\n");
+	exit(1);
+      }
+      list_backend = backends[n];
+      break;
+    case 'P':
+      prefetch_distance = atoi(optarg);
+      if (prefetch_distance < 0) {
+	fprintf(stderr, "Prefetch distance cannot be negative.\r\n");
+	exit(1);
+      }
+      break;
+    case 'r':
+      record_file = optarg;
+      break;
+    case 'R':
+      replay_file = optarg;
+      break;
+    case 'B':
+      batch_size = atoi(optarg);
+      if (batch_size < 1 || batch_size > SORTEDLIST_MAX_BATCH) {
+	fprintf(stderr, "Batch size must be from 1 to %d.\r\n",
+		SORTEDLIST_MAX_BATCH);
+	exit(1);
+      }
+      break;
+    case 'u':
+      if (strcmp(optarg, "deferred") == 0)
+	opt_deferred = 1;
+      else if (strcmp(optarg, "eager") != 0) {
+	fprintf(stderr, "Unlink options are: eager, deferred\r\n");
+	exit(1);
+      }
+      break;
+    case 'o':
+      if (strcmp(optarg, "strict") == 0)
+	opt_pop = POP_STRICT;
+      else if (strcmp(optarg, "relaxed") == 0)
+	opt_pop = POP_RELAXED;
+      else {
+	fprintf(stderr, "Pop options are: strict, relaxed\r\n");
+	exit(1);
+      }
+      break;
+    case 'a':
+      save_file = optarg;
+      break;
+    case 'L':
+      load_file = optarg;
+      break;
+    case 'D':
+      preload_count = atol(optarg);
+      if (preload_count < 0) {
+	fprintf(stderr, "Preload count cannot be negative.\r\n");
+	exit(1);
+      }
+      break;
+    case 'v':
+      verify_threads = atoi(optarg);
+      if (verify_threads < 1) {
+	fprintf(stderr, "Verify threads must be at least 1.\r\n");
+	exit(1);
+      }
+      break;
     default:
       fprintf(stderr, correct_usage);
       exit(1);
@@ -276,8 +802,58 @@ void process_args(int argc, char* argv[]) {
     fprintf(stderr, ". %s", correct_usage);
     exit(1);
   }
-  num_elements = num_threads * num_iterations;
+  if (record_file != NULL && replay_file != NULL) {
+    fprintf(stderr, "--record and --replay cannot be combined.\r\n");
+    exit(1);
+  }
+  /* the recording is the phased insert, lookup/delete run, which these
+     options replace or start from different lists */
+  if (record_file != NULL && (opt_pop != POP_NONE || batch_size > 1 ||
+			      load_file != NULL || preload_count > 0)) {
+    fprintf(stderr, "--record cannot be combined with --pop, --batch, "
+	    "--load or --preload.\r\n");
+    exit(1);
+  }
+  if (replay_file != NULL) {  /* the file decides threads and elements */
+    Workload_read(replay_file, &workload);
+    num_threads = workload.threads;
+    num_iterations = workload.elements / workload.threads;
+    num_elements = workload.elements;
+  }
+  else
+    num_elements = num_threads * num_iterations;
   limit_iterations(num_elements);
+  if (batch_size > 1 && (list_backend != &sorted_backend || opt_delegate ||
+			 replay_file != NULL)) {
+    fprintf(stderr, "--batch only applies to the list backend, without "
+	    "--sync=d or --replay.\r\n");
+    exit(1);
+  }
+  if (opt_deferred && (list_backend != &sorted_backend || opt_delegate ||
+		       strcmp(str_sync, "none") == 0)) {
+    fprintf(stderr, "--unlink=deferred needs the list backend with "
+	    "--sync=m, s or f.\r\n");
+    exit(1);
+  }
+  if (opt_pop != POP_NONE && (list_backend != &sorted_backend ||
+			      opt_delegate || opt_deferred ||
+			      batch_size > 1 || replay_file != NULL)) {
+    fprintf(stderr, "--pop needs the list backend, without --sync=d, "
+	    "--unlink=deferred, --batch or --replay.\r\n");
+    exit(1);
+  }
+  if ((save_file != NULL || load_file != NULL || preload_count > 0) &&
+      (list_backend != &sorted_backend || opt_pop != POP_NONE ||
+       (save_file != NULL && replay_file != NULL))) {
+    fprintf(stderr, "--save, --load and --preload need the list backend, "
+	    "without --pop; --save cannot be used with --replay.\r\n");
+    exit(1);
+  }
+  if (opt_delegate)
+    list_backend = Delegation_wrap(list_backend);
+  if (use_tsc && PreciseTimer_use_tsc() == 0)
+    fprintf(stderr, "No invariant TSC on this machine, timing with "
+	    "clock_gettime instead.\r\n");
 }
 
 
@@ -315,6 +891,104 @@ void randomize_list_elements(int seed) {
 }
 
 
+/*! Takes the keys of a replayed workload as the elements. */
+void load_workload_elements(void) {
+  long n;
+  list_elements = malloc(num_elements * sizeof(SortedListElement_t));
+  for (n = 0; n < num_elements; n++) {
+    SortedListElement_t element = { NULL, NULL, workload.keys[n] };
+    list_elements[n] = element;
+  }
+  free(workload.keys);  /* the keys now belong to list_elements */
+  workload.keys = NULL;
+}
+
+
+/*! Fills the sublists with preload_count more random elements, sorted
+ *  and linked by SortedList_bulk_load on num_threads threads. */
+void preload_lists(void) {
+  char key[129];
+  long n;
+  int m;
+  preload_elements = malloc(preload_count * sizeof(SortedListElement_t));
+  memset(key, 0, 129);
+  for (n = 0; n < preload_count; n++) {
+    for (m = 0; m < KEY_BITS; m++)
+      key[m] = (rand() % VISIBLE_ASCII_CHARS) + VISIBLE_ASCII_OFFSET;
+    SortedListElement_t element = { NULL, NULL, strdup(key) };
+    preload_elements[n] = element;
+  }
+  SortedList_bulk_load(list, num_lists, preload_elements, preload_count,
+		       get_bin, num_threads);
+}
+
+
+static int compare_ranks(const void *a, const void *b) {
+  return strcmp(list_elements[*(const long*) a].key,
+		list_elements[*(const long*) b].key);
+}
+
+
+/*! Ranks every element by key, for scoring pop_min. */
+void rank_elements(void) {
+  long *order = malloc(num_elements * sizeof(long));
+  long n;
+  element_rank = malloc(num_elements * sizeof(long));
+  for (n = 0; n < num_elements; n++)
+    order[n] = n;
+  qsort(order, num_elements, sizeof(long), compare_ranks);
+  for (n = 0; n < num_elements; n++)
+    element_rank[order[n]] = n;
+  free(order);
+}
+
+
+/*! Writes the operations list_operations() is about to run, with the
+ *  keys randomize_list_elements() drew, so the run can be replayed. */
+void record_workload(void) {
+  struct Workload recorded;
+  struct WorkloadOp *op;
+  long n;
+  int t;
+  recorded.threads = num_threads;
+  recorded.elements = num_elements;
+  recorded.key_length = KEY_BITS;
+  recorded.keys = malloc(num_elements * sizeof(char*));
+  recorded.count = malloc(num_threads * sizeof(long));
+  recorded.ops = malloc(num_threads * sizeof(struct WorkloadOp*));
+  for (n = 0; n < num_elements; n++)
+    recorded.keys[n] = (char*) list_elements[n].key;
+
+  for (t = 0; t < num_threads; t++) {
+    /* inserts, barrier, length, lookup/deletes, barrier */
+    recorded.count[t] = 2 * num_iterations + 3;
+    op = malloc(recorded.count[t] * sizeof(struct WorkloadOp));
+    recorded.ops[t] = op;
+    for (n = t * num_iterations; n < (t + 1) * num_iterations; n++, op++) {
+      op->op = WORKLOAD_INSERT;
+      op->element = n;
+    }
+    op->op = WORKLOAD_BARRIER;
+    (op++)->element = 0;
+    op->op = WORKLOAD_LENGTH;
+    (op++)->element = 0;
+    for (n = t * num_iterations; n < (t + 1) * num_iterations; n++, op++) {
+      op->op = WORKLOAD_DELETE;
+      op->element = n;
+    }
+    op->op = WORKLOAD_BARRIER;
+    op->element = 0;
+  }
+
+  Workload_write(record_file, &recorded);
+  for (t = 0; t < num_threads; t++)
+    free(recorded.ops[t]);
+  free(recorded.ops);
+  free(recorded.count);
+  free(recorded.keys);
+}
+
+
 void create_threads(pthread_t* threads) {
   int t;
   thread_id = calloc(num_threads, sizeof(int));
@@ -322,7 +996,9 @@ void create_threads(pthread_t* threads) {
     thread_id[t] = t;
   }
   for (t = 0; t < num_threads; t++) {
-    if (pthread_create(&threads[t], NULL, list_operations, 
+    if (pthread_create(&threads[t], NULL,
+		       replay_file != NULL ? replay_operations :
+		       opt_pop != POP_NONE ? pop_operations : list_operations,
 		       &thread_id[t]) != 0) {
       fprintf(stderr, "On thread %d: ", t+1);
       switch (errno) {
@@ -380,16 +1056,15 @@ void join_threads(pthread_t* threads) {
 
 
 void check_correct_list_length(int enforce, long long *timer) {
-  struct ListInfo sList;
+  long long lock_time = 0;
   int count;
   int bin;
   for (bin = 0; bin < num_lists; bin++) {
-    set_up_ListInfo(&sList, (void*) &list[bin], bin);
     pthread_mutex_lock(&mut);
     if (list_count[bin] == 0) {
       list_count[bin] = 1;
       pthread_mutex_unlock(&mut);
-      count = SortedList_length((SortedList_t*) &sList);
+      count = list_backend->length(bin, &lock_time);
       if (count == -1 && enforce == 1) {
 	fprintf(stderr, "List was corrupted during 'length' operation.\r\n");
 	exit(2);
@@ -399,7 +1074,114 @@ void check_correct_list_length(int enforce, long long *timer) {
     }
     pthread_mutex_unlock(&mut);
   }
-  *timer = sList.timer;
+  *timer = lock_time;
+}
+
+
+/*! Checks one element in place, counting it when it is in a list: it
+ *  must point at neighbours that point back, follow its predecessor in
+ *  key order and share its predecessor's sublist. */
+static void verify_element(struct VerifyTask *task, SortedListElement_t *el) {
+  SortedListElement_t *prev = el->prev;
+  int bin;
+  if (prev == NULL)             /* not in any list */
+    return;
+  task->count++;
+  bin = get_bin(el->key);
+  if (prev->next != el || (el->next != NULL && el->next->prev != el))
+    task->corrupt = 1;
+  else if (prev->key == NULL) {   /* first element after a head */
+    if (prev != &list[bin])
+      task->corrupt = 1;
+  }
+  else if (strcmp(prev->key, el->key) > 0 || get_bin(prev->key) != bin)
+    task->corrupt = 1;
+}
+
+
+/*! Checks this task's slice of list_elements and of the --preload
+ *  elements, which between them hold every node unless a snapshot was
+ *  loaded. Heads are shared out the same way. Only valid once no
+ *  operations are in flight. */
+static void* verify_elements(void *arg) {
+  struct VerifyTask *task = (struct VerifyTask*) arg;
+  long start = task->id * num_elements / verify_threads;
+  long end = (task->id + 1) * num_elements / verify_threads;
+  int bin;
+  long n;
+
+  for (bin = task->id; bin < num_lists; bin += verify_threads)
+    if (list[bin].next != NULL && list[bin].next->prev != &list[bin])
+      task->corrupt = 1;
+
+  for (n = start; n < end && task->corrupt == 0; n++)
+    verify_element(task, &list_elements[n]);
+
+  start = task->id * preload_count / verify_threads;
+  end = (task->id + 1) * preload_count / verify_threads;
+  for (n = start; n < end && task->corrupt == 0; n++)
+    verify_element(task, &preload_elements[n]);
+  return NULL;
+}
+
+
+/*! Backends without element links, and lists holding snapshot nodes
+ *  that no element array covers, are checked a sublist at a time. */
+static void* verify_bins(void *arg) {
+  struct VerifyTask *task = (struct VerifyTask*) arg;
+  long long lock_time;
+  int count;
+  int bin;
+  for (bin = task->id; bin < num_lists; bin += verify_threads) {
+    count = list_backend->length(bin, &lock_time);
+    if (count == -1) {
+      task->corrupt = 1;
+      break;
+    }
+    task->count += count;
+  }
+  return NULL;
+}
+
+
+/*! Final integrity check, fanned out over verify_threads threads with
+ *  the main thread taking the first share. The SortedList is split
+ *  into slices of list_elements, so even a single list is checked in
+ *  parallel; other backends are split by sublist. */
+void verify_lists(void) {
+  struct VerifyTask *tasks;
+  pthread_t *verifiers;
+  void *(*verify)(void*);
+  int corrupt = 0;
+  int t;
+
+  verify = (strcmp(list_backend->name, sorted_backend.name) == 0 &&
+	    loaded_count == 0) ? verify_elements : verify_bins;
+  tasks = calloc(verify_threads, sizeof(struct VerifyTask));
+  verifiers = calloc(verify_threads, sizeof(pthread_t));
+  for (t = 0; t < verify_threads; t++)
+    tasks[t].id = t;
+  for (t = 1; t < verify_threads; t++) {
+    if (pthread_create(&verifiers[t], NULL, verify, &tasks[t]) != 0) {
+      fprintf(stderr, "Verifier thread could not be created.\r\n%s\r\n",
+	      strerror(errno));
+      exit(2);
+    }
+  }
+  verify(&tasks[0]);
+  for (t = 1; t < verify_threads; t++)
+    pthread_join(verifiers[t], NULL);
+
+  for (t = 0; t < verify_threads; t++) {
+    corrupt |= tasks[t].corrupt;
+    *list_count_total += tasks[t].count;
+  }
+  free(tasks);
+  free(verifiers);
+  if (corrupt) {
+    fprintf(stderr, "List was corrupted, found during verification.\r\n");
+    exit(2);
+  }
 }
 
 
@@ -424,6 +1206,14 @@ int delete_list(void) {
   if (list_count_total != NULL) free(list_count_total);
   if (threads_finished_inserting != NULL) free(threads_finished_inserting);
   if (threads_finished_deleting != NULL) free(threads_finished_deleting);
+  Workload_free(&workload);
+  if (element_rank != NULL) free(element_rank);
+  if (preload_elements != NULL) {
+    for (n = 0; n < preload_count; n++)
+      free((void*)preload_elements[n].key);
+    free(preload_elements);
+  }
+  Snapshot_unload();
   return 1;
 }
 
@@ -467,12 +1257,14 @@ void append_csv(long long run_time) {
 
   /* insert, lookup, delete for each thread for # iterations */
   char* test_name = compute_test_name();
-  long num_operations = 3 * num_threads * num_iterations;
+  long num_operations = (replay_file != NULL) ? workload.operations :
+    (opt_pop != POP_NONE) ? 2 * num_threads * num_iterations :
+    3 * num_threads * num_iterations;
   long long average_time_per_op = run_time / (long long)num_operations;
   long long wait_time = *wait_for_time / (long long)num_operations;
-  char output[80];
+  char output[320];  /* 63-char name, 7 numbers, perf and pop columns */
   int num_chars;
-  num_chars = sprintf(output, "%s,%d,%ld,%d,%ld,%lld,%ld,%lld\n",
+  num_chars = sprintf(output, "%s,%d,%ld,%d,%ld,%lld,%ld,%lld",
 	  test_name,
 	  num_threads,
 	  num_iterations,
@@ -481,6 +1273,13 @@ void append_csv(long long run_time) {
 	  run_time,
 	  average_time_per_op,
 	  wait_time);
+  if (opt_perf)
+    num_chars += PerfCounters_format(output + num_chars, &perf_total,
+				     num_operations);
+  if (opt_pop != POP_NONE)  /* mean rank error per pop */
+    num_chars += sprintf(output + num_chars, ",%lld",
+			 rank_error_total / (num_threads * num_iterations));
+  num_chars += sprintf(output + num_chars, "\n");
   
   if (num_chars == -1) {
     fprintf(stderr, 
@@ -531,9 +1330,34 @@ void append_csv(long long run_time) {
 
 
 char* compute_test_name(void) {
-  static char str_result[16];
-  memset(str_result, 0, 16);
-  sprintf(str_result, "list-%s-%s", str_yield, str_sync);
+  static char str_result[64];
+  size_t used;
+  snprintf(str_result, sizeof(str_result), "%s-%s-%s",
+	   list_backend->name, str_yield, str_sync);
+  /* each suffix gets what is left; a truncated name beats an overflow */
+  used = strlen(str_result);
+  if (prefetch_distance > 0) {
+    snprintf(str_result + used, sizeof(str_result) - used, "-p%d",
+	     prefetch_distance);
+    used = strlen(str_result);
+  }
+  if (batch_size > 1) {
+    snprintf(str_result + used, sizeof(str_result) - used, "-b%d",
+	     batch_size);
+    used = strlen(str_result);
+  }
+  if (opt_deferred) {
+    snprintf(str_result + used, sizeof(str_result) - used, "-deferred");
+    used = strlen(str_result);
+  }
+  if (opt_pop != POP_NONE) {
+    snprintf(str_result + used, sizeof(str_result) - used, "%s",
+	     opt_pop == POP_STRICT ? "-strict" : "-relaxed");
+    used = strlen(str_result);
+  }
+  if (preload_count > 0)
+    snprintf(str_result + used, sizeof(str_result) - used, "-e%ld",
+	     preload_count);
   return str_result;
 }
 
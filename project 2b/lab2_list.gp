@@ -4,14 +4,22 @@
 #	 generate data reduction graphs for the multi-threaded list project
 #
 # input: lab2b_list.csv
-#	1. test name
+#	1. test name (<backend>-<yield>-<sync>, e.g. list-none-m)
 #	2. # threads
 #	3. # iterations per thread
 #	4. # lists
 #	5. # operations performed (threads x iterations x (ins + lookup + delete))
 #	6. run time (ns)
 #	7. run time per operation (ns)
-#	8. wait for lock time (ns)
+#	8. wait for lock time (ns); with --sync=d, time waiting for the owner
+#	with --perf, per-operation counts follow:
+#	9. cycles (task-clock ns with software counters)
+#	10. instructions (-1 with software counters)
+#	11. LLC misses (page faults with software counters)
+#	12. context switches
+#	13. counter source (hw, sw or none)
+#	with --pop, the mean rank error per pop_min comes last (9. without
+#	--perf), and ops counts inserts and pops
 #
 # output:
 #	lab2b_1.png ... throughput vs threads with single list
@@ -19,6 +27,14 @@
 #	lab2b_3.png ... threads and iterations that run w/o failure
 #	lab2b_4.png ... throughput vs threads with sub lists w/mutex
 #       lab2b_5.png ... throughput vs threads with sub lists w/spin-lock
+#	lab2b_6.png ... time per operation vs list size w/ software prefetch
+#	lab2b_7.png ... throughput vs threads for each --backend
+#	lab2b_8.png ... throughput vs threads for batched lookups
+#	lab2b_9.png ... pop_min throughput and rank error, strict vs relaxed
+#
+#	Runs with --prefetch=D are named list-<yield>-<sync>-pD, and runs
+#	with --batch=K end in -bK, --unlink=deferred in -deferred,
+#	--pop in -strict or -relaxed, and --preload=N in -eN.
 #
 # Note:
 #	Managing data is simplified by keeping all of the results in a single
@@ -50,6 +66,14 @@ plot \
         grep -e 's,[1248],' -e 's,12,' -e 's,16' -e 's,24'"  \
 	using ($2):(1000000000/($7)) \
 	title 'list w/spin-lock' with linespoints lc rgb 'orange', \
+     "< cat lab2b_list.csv | grep 'list-none-f,[0-9]*,1000,1,' | \
+        grep -e 'f,[1248],' -e 'f,12,' -e 'f,16' -e 'f,24'"  \
+	using ($2):(1000000000/($7)) \
+	title 'list w/adaptive futex' with linespoints lc rgb 'red', \
+     "< cat lab2b_list.csv | grep 'list-none-d,[0-9]*,1000,1,' | \
+        grep -e 'd,[1248],' -e 'd,12,' -e 'd,16' -e 'd,24'"  \
+	using ($2):(1000000000/($7)) \
+	title 'list w/delegation' with linespoints lc rgb 'green', \
 
 
 # time waiting for a lock vs. overall time per operation per \
@@ -163,4 +187,112 @@ plot \
      "< cat lab2b_list.csv | grep 'list-none-s' | \
         grep -e 's,[1248],1000,16,' -e 's,12,1000,16,'" \
 	using ($2):(1000000000/($7)) \
-	title '16 sublists' with linespoints lc rgb 'orange'
\ No newline at end of file
+	title '16 sublists' with linespoints lc rgb 'orange'
+
+
+# pointer chasing cost as the list outgrows the caches
+# the list size is the N of the -eN suffix; 16 sublists share it
+preloaded(name) = real(name[strstrt(name, "-e") + 2:strlen(name)])
+set title "List-6: Software prefetch distance vs list size (1 thread)"
+set xlabel "Elements preloaded"
+set logscale x 2
+unset xrange
+set xrange [100000:]
+set ylabel "Time per operation (ns)"
+set logscale y 10
+set output 'lab2b_6.png'
+set key left top
+
+plot \
+     "< grep 'list-none-none-e[0-9]*,1,' lab2b_list.csv" \
+	using (preloaded(strcol(1))):($7) \
+	title 'no prefetch' with linespoints lc rgb 'blue', \
+     "< grep 'list-none-none-p1-e[0-9]*,1,' lab2b_list.csv" \
+	using (preloaded(strcol(1))):($7) \
+	title 'distance 1' with linespoints lc rgb 'violet', \
+     "< grep 'list-none-none-p4-e[0-9]*,1,' lab2b_list.csv" \
+	using (preloaded(strcol(1))):($7) \
+	title 'distance 4' with linespoints lc rgb 'red', \
+     "< grep 'list-none-none-p16-e[0-9]*,1,' lab2b_list.csv" \
+	using (preloaded(strcol(1))):($7) \
+	title 'distance 16' with linespoints lc rgb 'orange'
+
+
+# the same driver over different ordered structures
+set title "List-7: Throughput of list backends"
+set xlabel "Threads"
+set logscale x 2
+unset xrange
+set xrange [0.75:]
+set ylabel "Throughput (1/s)"
+set logscale y 10
+set output 'lab2b_7.png'
+set key left top
+
+plot \
+     "< grep -e 'list-none-m,[0-9]*,1000,1,' lab2b_list.csv" \
+	using ($2):(1000000000/($7)) \
+	title 'list w/mutex, 1 list' with linespoints lc rgb 'blue', \
+     "< grep -e 'list-none-m,[0-9]*,1000,16,' lab2b_list.csv" \
+	using ($2):(1000000000/($7)) \
+	title 'list w/mutex, 16 lists' with linespoints lc rgb 'violet', \
+     "< grep -e 'compact-none-m,[0-9]*,1000,1,' lab2b_list.csv" \
+	using ($2):(1000000000/($7)) \
+	title 'compact w/mutex, 1 list' with linespoints lc rgb 'orange', \
+     "< grep -e 'bplus-none-none,[0-9]*,1000,1,' lab2b_list.csv" \
+	using ($2):(1000000000/($7)) \
+	title 'B+-tree (OLC), 1 tree' with linespoints lc rgb 'red', \
+     "< grep -e 'art-none-none,[0-9]*,1000,1,' lab2b_list.csv" \
+	using ($2):(1000000000/($7)) \
+	title 'radix tree (OLC), 1 tree' with linespoints lc rgb 'green'
+
+
+# several lookups in flight per thread instead of one
+set title "List-8: Throughput of interleaved batched lookups"
+set xlabel "Threads"
+set logscale x 2
+unset xrange
+set xrange [0.75:]
+set ylabel "Throughput (1/s)"
+set logscale y 10
+set output 'lab2b_8.png'
+set key left top
+
+plot \
+     "< grep -e 'list-none-m,[1248],1000,1,' lab2b_list.csv" \
+	using ($2):(1000000000/($7)) \
+	title 'one lookup at a time' with linespoints lc rgb 'blue', \
+     "< grep -e 'list-none-m-b4,[1248],1000,1,' lab2b_list.csv" \
+	using ($2):(1000000000/($7)) \
+	title 'batches of 4' with linespoints lc rgb 'violet', \
+     "< grep -e 'list-none-m-b16,[1248],1000,1,' lab2b_list.csv" \
+	using ($2):(1000000000/($7)) \
+	title 'batches of 16' with linespoints lc rgb 'orange'
+
+
+# exact vs relaxed pop_min: throughput gained for rank error given up
+set title "List-9: pop_min, strict vs relaxed (MultiQueue), 8 lists"
+set xlabel "Threads"
+set logscale x 2
+unset xrange
+set xrange [0.75:]
+set ylabel "Throughput (1/s)"
+set logscale y 10
+set y2label "Mean rank error"
+set y2tics
+set output 'lab2b_9.png'
+set key left top
+
+plot \
+     "< grep -e 'list-none-m-strict,[0-9]*,1000,8,' lab2b_list.csv" \
+	using ($2):(1000000000/($7)) \
+	title 'strict throughput' with linespoints lc rgb 'blue', \
+     "< grep -e 'list-none-m-relaxed,[0-9]*,1000,8,' lab2b_list.csv" \
+	using ($2):(1000000000/($7)) \
+	title 'relaxed throughput' with linespoints lc rgb 'orange', \
+     "< grep -e 'list-none-m-strict,[0-9]*,1000,8,' lab2b_list.csv" \
+	using ($2):($9) axes x1y2 \
+	title 'strict rank error' with linespoints dt 2 lc rgb 'blue', \
+     "< grep -e 'list-none-m-relaxed,[0-9]*,1000,8,' lab2b_list.csv" \
+	using ($2):($9) axes x1y2 \
+	title 'relaxed rank error' with linespoints dt 2 lc rgb 'orange'